@@ -24,12 +24,22 @@ directed_graph::directed_graph(const directed_graph &gr)
 	copy(gr);
 }
 
+directed_graph::directed_graph(directed_graph &&gr) noexcept
+	: graph_base(std::move(gr))
+{}
+
 directed_graph& directed_graph::operator=(const directed_graph &gr)
 {
 	copy(gr);
 	return (*this);
 }
 
+directed_graph& directed_graph::operator=(directed_graph &&gr)
+{
+	take(gr);
+	return (*this);
+}
+
 directed_graph::~directed_graph()
 {
 }
@@ -38,7 +48,7 @@ edge_descriptor directed_graph::add_edge(int s, int t)
 {
 	assert(s >= 0 && s < vv.size());
 	assert(t >= 0 && t < vv.size());
-	edge_base *e = new edge_base(s, t);
+	edge_base *e = new edge_base(s, t, num_edge_ids++);
 	assert(se.find(e) == se.end());
 	se.insert(e);
 	vv[s]->add_out_edge(e);
@@ -19,7 +19,9 @@ class directed_graph : public graph_base
 public:
 	directed_graph();
 	directed_graph(const directed_graph &gr);
+	directed_graph(directed_graph &&gr) noexcept;
 	directed_graph& operator=(const directed_graph &gr);
+	directed_graph& operator=(directed_graph &&gr);
 	virtual ~directed_graph();
 
 public:
@@ -0,0 +1,87 @@
+/*
+Part of Scallop Transcript Assembler
+(c) 2017 by  Mingfu Shao, Carl Kingsford, and Carnegie Mellon University.
+See LICENSE for licensing.
+*/
+
+#include "disjoint_set.h"
+
+#include <cassert>
+
+disjoint_set::disjoint_set()
+{
+	num_sets = 0;
+}
+
+disjoint_set::disjoint_set(int n)
+{
+	init(n);
+}
+
+int disjoint_set::init(int n)
+{
+	parent.resize(n);
+	rank.assign(n, 0);
+	for(int i = 0; i < n; i++) parent[i] = i;
+	num_sets = n;
+	return 0;
+}
+
+int disjoint_set::find(int x)
+{
+	assert(x >= 0 && x < parent.size());
+	while(parent[x] != x)
+	{
+		parent[x] = parent[parent[x]];
+		x = parent[x];
+	}
+	return x;
+}
+
+bool disjoint_set::join(int x, int y)
+{
+	x = find(x);
+	y = find(y);
+	if(x == y) return false;
+
+	if(rank[x] < rank[y]) parent[x] = y;
+	else if(rank[x] > rank[y]) parent[y] = x;
+	else
+	{
+		parent[y] = x;
+		rank[x]++;
+	}
+	num_sets--;
+	return true;
+}
+
+int disjoint_set::join(const vector< pair<int, int> > &edges)
+{
+	int n = 0;
+	for(int i = 0; i < edges.size(); i++)
+	{
+		if(join(edges[i].first, edges[i].second)) n++;
+	}
+	return n;
+}
+
+int disjoint_set::components() const
+{
+	return num_sets;
+}
+
+int disjoint_set::labels(vector<int> &v)
+{
+	// components are labeled in the order of their smallest vertex
+	vector<int> m(parent.size(), -1);
+	v.assign(parent.size(), -1);
+	int k = 0;
+	for(int i = 0; i < parent.size(); i++)
+	{
+		int r = find(i);
+		if(m[r] == -1) m[r] = k++;
+		v[i] = m[r];
+	}
+	assert(k == num_sets);
+	return k;
+}
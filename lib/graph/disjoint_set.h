@@ -0,0 +1,37 @@
+/*
+Part of Scallop Transcript Assembler
+(c) 2017 by  Mingfu Shao, Carl Kingsford, and Carnegie Mellon University.
+See LICENSE for licensing.
+*/
+
+#ifndef __DISJOINT_SET_H__
+#define __DISJOINT_SET_H__
+
+#include <vector>
+#include <utility>
+
+using namespace std;
+
+// union-find over vertices 0, ..., n-1, 
+// with union by rank and path halving
+class disjoint_set
+{
+public:
+	disjoint_set();
+	disjoint_set(int n);
+
+private:
+	vector<int> parent;
+	vector<int> rank;
+	int num_sets;
+
+public:
+	int init(int n);
+	int find(int x);
+	bool join(int x, int y);
+	int join(const vector< pair<int, int> > &edges);
+	int components() const;
+	int labels(vector<int> &v);
+};
+
+#endif
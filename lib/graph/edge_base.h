@@ -18,16 +18,19 @@ class edge_base
 {
 public:
 	edge_base(int _s, int _t);
+	edge_base(int _s, int _t, int _id);
 
 protected:
 	int s;					// source
 	int t;					// target
+	int id;					// dense index in its graph, never reused
 
 public:
 	virtual int move(int x, int y);
 	virtual int swap();
 	virtual int source() const;
 	virtual int target() const;
+	virtual int index() const;
 	virtual int print() const;
 };
 
@@ -15,7 +15,9 @@ See LICENSE for licensing.
 using namespace std;
 
 graph_base::graph_base()
-{}
+{
+	num_edge_ids = 0;
+}
 
 graph_base::~graph_base()
 {
@@ -24,9 +26,27 @@ graph_base::~graph_base()
 
 graph_base::graph_base(const graph_base &gr)
 {
+	num_edge_ids = 0;
 	//copy(gr); !!!
 }
 
+graph_base::graph_base(graph_base &&gr) noexcept
+{
+	num_edge_ids = 0;
+	take(gr);
+}
+
+int graph_base::take(graph_base &gr)
+{
+	if(&gr == this) return 0;
+	clear();
+	vv.swap(gr.vv);
+	se.swap(gr.se);
+	num_edge_ids = gr.num_edge_ids;
+	gr.num_edge_ids = 0;
+	return 0;
+}
+
 int graph_base::copy(const graph_base &gr)
 {
 	clear();
@@ -76,9 +96,15 @@ int graph_base::clear()
 	}
 	vv.clear();
 	se.clear();
+	num_edge_ids = 0;
 	return 0;
 }
 
+int graph_base::edge_id_bound() const
+{
+	return num_edge_ids;
+}
+
 int graph_base::degree(int v) const
 {
 	return vv[v]->degree();
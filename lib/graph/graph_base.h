@@ -33,15 +33,18 @@ class graph_base
 public:
 	graph_base();
 	graph_base(const graph_base &gr);
+	graph_base(graph_base &&gr) noexcept;
 	virtual ~graph_base();
 
 protected:
 	vector<vertex_base*> vv;
 	set<edge_base*> se;
+	int num_edge_ids;				// ids of edges are in [0, num_edge_ids)
 
 public:
 	// modify the graph
 	virtual int copy(const graph_base &gr);
+	int take(graph_base &gr);		// take over vertices and edges of gr
 	virtual int add_vertex();
 	virtual int clear_vertex(int v);
 	virtual int clear();
@@ -53,6 +56,7 @@ public:
 	virtual size_t support_size() const;
 	virtual size_t num_vertices() const;
 	virtual size_t num_edges() const;
+	virtual int edge_id_bound() const;
 	virtual int degree(int v) const;
 	virtual PEB edge(int s, int t);
 	virtual PEEI edges() const;
@@ -37,7 +37,7 @@ edge_descriptor undirected_graph::add_edge(int s, int t)
 {
 	assert(s >= 0 && s < vv.size());
 	assert(t >= 0 && t < vv.size());
-	edge_base *e = new edge_base(s, t);
+	edge_base *e = new edge_base(s, t, num_edge_ids++);
 	assert(se.find(e) == se.end());
 	se.insert(e);
 	vv[s]->add_out_edge(e);
@@ -85,42 +85,36 @@ PEEI undirected_graph::out_edges(int x)
 	return p;
 }
 
-vector<int> undirected_graph::assign_connected_components()
+int undirected_graph::build_disjoint_set(disjoint_set &ds)
 {
-	vector<bool> mm;
-	vector<int> vv;
-	mm.assign(num_vertices(), false);
-	vv.assign(num_vertices(), -1);
-
-	int cc = 0;
-	for(int i = 0; i < num_vertices(); i++)
+	ds.init(num_vertices());
+	for(set<edge_base*>::const_iterator it = se.begin(); it != se.end(); it++)
 	{
-		if(mm[i] == true) continue;
-		vector<int> v;
-		bfs(i, v);
-		for(int k = 0; k < v.size(); k++) mm[v[k]] = true;
-		for(int k = 0; k < v.size(); k++) vv[v[k]] = cc;
-		cc++;
+		ds.join((*it)->source(), (*it)->target());
 	}
+	return ds.components();
+}
+
+vector<int> undirected_graph::assign_connected_components()
+{
+	vector<int> vv;
+	assign_connected_components(vv);
 	return vv;
 }
 
-vector< set<int> > undirected_graph::compute_connected_components()
+int undirected_graph::assign_connected_components(vector<int> &vv)
 {
-	vector<bool> m;
-	m.assign(num_vertices(), false);
-	vector< set<int> > vv;
+	disjoint_set ds;
+	build_disjoint_set(ds);
+	return ds.labels(vv);
+}
 
-	for(int i = 0; i < num_vertices(); i++)
-	{
-		if(m[i] == true) continue;
-		vector<int> v;
-		bfs(i, v);
-		set<int> s(v.begin(), v.end());
-		assert(s.find(i) != s.end());
-		vv.push_back(s);
-		for(int k = 0; k < v.size(); k++) m[v[k]] = true;
-	}
+vector< set<int> > undirected_graph::compute_connected_components()
+{
+	vector<int> v;
+	int n = assign_connected_components(v);
+	vector< set<int> > vv(n);
+	for(int i = 0; i < v.size(); i++) vv[v[i]].insert(vv[v[i]].end(), i);
 	return vv;
 }
 
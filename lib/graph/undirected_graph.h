@@ -11,6 +11,7 @@ See LICENSE for licensing.
 #include <map>
 
 #include "graph_base.h"
+#include "disjoint_set.h"
 
 using namespace std;
 
@@ -35,6 +36,8 @@ public:
 	virtual bool intersect(edge_descriptor ex, edge_descriptor ey);
 	vector< set<int> > compute_connected_components();
 	vector<int> assign_connected_components();
+	int assign_connected_components(vector<int> &v);	// return #components
+	int build_disjoint_set(disjoint_set &ds);
 
 	// print and draw
 	int draw(const string &file, const MIS &mis, const MES &mes, double len);
@@ -149,6 +149,19 @@ set<int32_t> gene::get_exon_boundaries() const
 	return s;
 }
 
+int gene::build_index()
+{
+	set<int32_t> s = get_exon_boundaries();
+	boundaries.assign(s.begin(), s.end());
+	return 0;
+}
+
+bool gene::is_exon_boundary(int32_t p) const
+{
+	// binary search in the cached boundaries
+	return binary_search(boundaries.begin(), boundaries.end(), p);
+}
+
 PI32 gene::get_bounds() const
 {
 	PI32 pp(-1, -1);
@@ -22,6 +22,7 @@ class gene
 public:
 	vector<transcript> transcripts;			
 	map<string, int> t2i;
+	vector<int32_t> boundaries;			// sorted exon boundaries, cached by build_index
 
 public:
 	// build
@@ -36,12 +37,14 @@ public:
 	int clear();
 	int set_gene_id(const string &id);
 	int assign_RPKM(double factor);
+	int build_index();
 
 	// filter
 	int filter_single_exon_transcripts();
 	int filter_low_coverage_transcripts(double min_coverage);
 
 	set<int32_t> get_exon_boundaries() const;
+	bool is_exon_boundary(int32_t p) const;
 	PI32 get_bounds() const;
 	string get_seqname() const;
 	string get_gene_id() const;
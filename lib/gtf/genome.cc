@@ -8,15 +8,20 @@ See LICENSE for licensing.
 #include <cassert>
 #include <sstream>
 #include <map>
+#include <climits>
+#include <algorithm>
 
 #include "genome.h"
 #include "util.h"
 
 genome::genome()
-{}
+{
+	num_indexed = 0;
+}
 
 genome::genome(const string &file)
 {
+	num_indexed = 0;
 	read(file);
 }
 
@@ -73,6 +78,7 @@ int genome::read(const string &file)
 		genes[i].shrink();
 	}
 
+	build_index();
 	return 0;
 }
 
@@ -96,6 +102,44 @@ int genome::sort()
 	return 0;
 }
 
+int genome::build_index()
+{
+	c2g.clear();
+	c2b.clear();
+	c2m.clear();
+
+	map<string, vector< pair<PI32, int> > > m;
+	for(int i = 0; i < genes.size(); i++)
+	{
+		genes[i].build_index();
+		if(genes[i].transcripts.size() == 0) continue;
+		m[genes[i].get_seqname()].push_back(pair<PI32, int>(genes[i].get_bounds(), i));
+	}
+
+	// with genes sorted by left bound, those overlapping a query
+	// form a run ending before the first gene starting after it,
+	// and the prefix maxima of right bounds tell where it begins
+	for(map<string, vector< pair<PI32, int> > >::iterator it = m.begin(); it != m.end(); it++)
+	{
+		vector< pair<PI32, int> > &v = it->second;
+		std::sort(v.begin(), v.end());
+
+		vector<int> &g = c2g[it->first];
+		vector<PI32> &b = c2b[it->first];
+		vector<int32_t> &x = c2m[it->first];
+		for(int k = 0; k < v.size(); k++)
+		{
+			g.push_back(v[k].second);
+			b.push_back(v[k].first);
+			if(k == 0 || v[k].first.second > x.back()) x.push_back(v[k].first.second);
+			else x.push_back(x.back());
+		}
+	}
+
+	num_indexed = genes.size();
+	return 0;
+}
+
 const gene* genome::get_gene(string name) const
 {
 	map<string, int>::const_iterator it = g2i.find(name);
@@ -107,24 +151,70 @@ const gene* genome::get_gene(string name) const
 const gene* genome::locate_gene(const string &chrm, const PI32 &p) const
 {
 	assert(p.first <= p.second);
+
+	// scan all genes if the index is out of date
+	vector<int> v;
+	if(num_indexed == genes.size()) overlap(chrm, p, v);
+	else for(int i = 0; i < genes.size(); i++) if(genes[i].get_seqname() == chrm) v.push_back(i);
+
+	// the largest overlap, the first gene among ties
 	const gene * x = NULL;
 	int32_t oo = 0;
-	for(int i = 0; i < genes.size(); i++)
+	for(int k = 0; k < v.size(); k++)
 	{
-		const gene &g = genes[i];
-		if(g.get_seqname() != chrm) continue;
+		const gene &g = genes[v[k]];
 		PI32 b = g.get_bounds();
 		assert(b.first <= b.second);
 		int32_t o = compute_overlap(p, b);
 		if(o > 0 && o > oo)
 		{
-			x = &(genes[i]);
+			x = &(genes[v[k]]);
 			oo = o;
 		}
 	}
 	return x;
 }
 
+int genome::overlap(const string &chrm, const PI32 &p, vector<int> &v) const
+{
+	// indices of genes overlapping p, in the order of genes
+	vector<PI32> ps(1, p);
+	vector< vector<int> > vv;
+	overlap(chrm, ps, vv);
+	v = vv[0];
+	return 0;
+}
+
+int genome::overlap(const string &chrm, const vector<PI32> &ps, vector< vector<int> > &vv) const
+{
+	// the chromosome is looked up once for all queries
+	vv.assign(ps.size(), vector<int>());
+
+	map<string, vector<int> >::const_iterator it = c2g.find(chrm);
+	if(it == c2g.end()) return 0;
+
+	const vector<int> &g = it->second;
+	const vector<PI32> &b = c2b.find(chrm)->second;
+	const vector<int32_t> &x = c2m.find(chrm)->second;
+
+	for(int i = 0; i < ps.size(); i++)
+	{
+		const PI32 &p = ps[i];
+
+		// genes [0, k) start before the end of p
+		int k = lower_bound(b.begin(), b.end(), PI32(p.second, INT32_MIN)) - b.begin();
+
+		// walk left until no earlier gene reaches into p
+		vector<int> &v = vv[i];
+		for(int j = k - 1; j >= 0 && x[j] > p.first; j--)
+		{
+			if(b[j].second > p.first) v.push_back(g[j]);
+		}
+		std::sort(v.begin(), v.end());
+	}
+	return 0;
+}
+
 int genome::assign_RPKM(double factor)
 {
 	for(int i = 0; i < genes.size(); i++)
@@ -24,6 +24,13 @@ public:
 	vector<gene> genes;
 	map<string, int> g2i;
 
+	// index of genes on each chromosome, built by build_index
+	// and to be rebuilt after genes are added or modified
+	map<string, vector<int> > c2g;			// genes sorted by left bound
+	map<string, vector<PI32> > c2b;			// bounds of these genes
+	map<string, vector<int32_t> > c2m;		// prefix maxima of right bounds
+	int num_indexed;						// number of genes indexed
+
 public:
 	// read and write
 	int read(const string &file);
@@ -44,6 +51,8 @@ public:
 	// fetch information
 	const gene* get_gene(string name) const;
 	const gene* locate_gene(const string &chr, const PI32 &p) const;
+	int overlap(const string &chrm, const PI32 &p, vector<int> &v) const;
+	int overlap(const string &chrm, const vector<PI32> &ps, vector< vector<int> > &vv) const;
 	vector<transcript> collect_transcripts() const;
 };
 
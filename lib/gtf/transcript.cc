@@ -44,6 +44,7 @@ int transcript::assign(const item &e)
 	RPKM = e.RPKM;
 	FPKM = e.FPKM;
 	TPM = e.TPM;
+	samples.clear();
 	return 0;
 }
 
@@ -75,6 +76,7 @@ int transcript::clear()
 	coverage = 0;
 	RPKM = 0;
 	TPM = 0;
+	samples.clear();
 	return 0;
 }
 
@@ -214,7 +216,14 @@ int transcript::write(ostream &fout) const
 	if(gene_type != "") fout<<"gene_type \""<<gene_type.c_str()<<"\"; ";
 	if(transcript_type != "") fout<<"transcript_type \""<<transcript_type.c_str()<<"\"; ";
 	fout<<"RPKM \""<<RPKM<<"\"; ";
-	fout<<"cov \""<<coverage<<"\";"<<endl;
+	fout<<"cov \""<<coverage<<"\";";
+	if(samples.size() >= 1)
+	{
+		fout<<" sample_cov \"";
+		for(int k = 0; k < samples.size(); k++) fout<<(k == 0 ? "" : ",")<<samples[k];
+		fout<<"\";";
+	}
+	fout<<endl;
 
 	for(int k = 0; k < exons.size(); k++)
 	{
@@ -45,6 +45,7 @@ public:
 	double RPKM;
 	double FPKM;
 	double TPM;
+	vector<double> samples;			// coverage of each input sample, if tracked
 
 	vector<PI32> exons;
 
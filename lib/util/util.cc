@@ -5,6 +5,7 @@ See LICENSE for licensing.
 */
 
 #include "util.h"
+#include <algorithm>
 
 vector<int> get_random_permutation(int n)
 {
@@ -21,3 +22,49 @@ vector<int> get_random_permutation(int n)
 }
 
 
+
+static bool radix_key_less(const pair<int64_t, int> &x, const pair<int64_t, int> &y)
+{
+	return x.first < y.first;
+}
+
+int radix_sort(vector< pair<int64_t, int> > &v)
+{
+	// stable LSD radix sort on the (non-negative) keys, 16 bits a pass;
+	// passes in which all keys share the same digit are skipped
+	if(v.size() <= 1) return 0;
+
+	// each pass costs 65536 counters, not worth it for fewer keys
+	if(v.size() < 65536)
+	{
+		stable_sort(v.begin(), v.end(), radix_key_less);
+		return 0;
+	}
+
+	vector< pair<int64_t, int> > w(v.size());
+	vector<int> cnt(65536);
+	for(int d = 0; d < 64; d += 16)
+	{
+		fill(cnt.begin(), cnt.end(), 0);
+		for(int i = 0; i < v.size(); i++) cnt[((uint64_t)(v[i].first) >> d) & 0xFFFF]++;
+
+		int x = ((uint64_t)(v[0].first) >> d) & 0xFFFF;
+		if(cnt[x] == v.size()) continue;
+
+		int s = 0;
+		for(int k = 0; k < cnt.size(); k++)
+		{
+			int t = cnt[k];
+			cnt[k] = s;
+			s += t;
+		}
+
+		for(int i = 0; i < v.size(); i++)
+		{
+			int k = ((uint64_t)(v[i].first) >> d) & 0xFFFF;
+			w[cnt[k]++] = v[i];
+		}
+		v.swap(w);
+	}
+	return 0;
+}
@@ -169,5 +169,6 @@ vector<K> get_keys(const map<K, V> &m)
 }
 
 vector<int> get_random_permutation(int n);
+int radix_sort(vector< pair<int64_t, int> > &v);
 
 #endif
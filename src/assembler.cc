@@ -7,7 +7,10 @@ See LICENSE for licensing.
 #include <cstdio>
 #include <cassert>
 #include <sstream>
+#include <cstdlib>
+#include <algorithm>
 
+#include "htslib/bgzf.h"
 #include "config.h"
 #include "gtf.h"
 #include "genome.h"
@@ -17,93 +20,256 @@ See LICENSE for licensing.
 #include "super_graph.h"
 #include "filter.h"
 
-assembler::assembler()
+assembler::assembler(const parameters &_cfg, previewer &pv)
+	: cfg(_cfg), bb1(&cfg), bb2(&cfg), workers(cfg.num_threads), cache(&cfg)
 {
-    sfn = sam_open(input_file.c_str(), "r");
-    hdr = sam_hdr_read(sfn);
-    b1t = bam_init1();
+	pv.release(reader);
+	reader.open(cfg.input_files);
+	if(cfg.regions_file != "")
+	{
+		int n = reader.set_regions(cfg.regions_file, cfg.min_bundle_gap);
+		if(cfg.verbose >= 1) printf("read %d merged regions from %s\n", n, cfg.regions_file.c_str());
+	}
+	bam_hdr_t *hdr = reader.header();
+	for(int i = 0; i < hdr->n_targets; i++) chrms.push_back(hdr->target_name[i]);
+	init();
+}
+
+assembler::assembler(const parameters &_cfg, const vector<string> &_chrms)
+	: cfg(_cfg), bb1(&cfg), bb2(&cfg), workers(cfg.num_threads), cache(&cfg), chrms(_chrms)
+{
+	init();
+}
+
+assembler::~assembler()
+{
+}
+
+int assembler::init()
+{
+	cfg.build_sweep(sweeps);
+	strsts.assign(sweeps.size(), vector<transcript>());
+	if(cfg.verbose >= 1 && sweeps.size() >= 1) printf("sweep %lu parameter settings from %s\n", sweeps.size(), cfg.sweep_file.c_str());
 	index = 0;
 	terminate = false;
 	qlen = 0;
 	qcnt = 0;
+	pool_bytes = 0;
+	spill_index = 0;
+	num_budget_graphs = 0;
+	num_quarantined = 0;
+	num_quarantined_hits = 0;
+	checkpoint_file = cfg.output_file + ".ckpt";
+	last_checkpoint = chrono::steady_clock::now();
+	return 0;
 }
 
-assembler::~assembler()
+int assembler::assemble()
 {
-    bam_destroy1(b1t);
-    bam_hdr_destroy(hdr);
-    sam_close(sfn);
+	if(cfg.bundle_cache_file != "" && cache.open_read() == true) replay_cache();
+	else read_inputs();
+
+	finish();
+
+	// a cache of an interrupted run would be incomplete
+	if(terminate == false) cache.close_write(qlen, qcnt);
+
+	if(sweeps.size() == 0) write(trsts, cfg.output_file);
+	for(int i = 0; i < sweeps.size(); i++) write(strsts[i], sweeps[i].output_file);
+	if(checkpoint_enabled() == true) remove(checkpoint_file.c_str());
+
+	if(cfg.verbose >= 1 && num_budget_graphs >= 1) printf("%d splice graphs exceeded the decomposing budget and were greedily decomposed\n", num_budget_graphs.load());
+	if(num_quarantined >= 1) printf("%d bundles with %lld hits were aborted and quarantined\n", num_quarantined, (long long)num_quarantined_hits);
+	
+	return 0;
 }
 
-int assembler::assemble()
+int assembler::read_inputs()
 {
-    while(sam_read1(sfn, hdr, b1t) >= 0)
+	if(cfg.resume == true && cfg.regions_file == "") read_checkpoint();
+
+	// bundles are saved while assembling, unless resumed
+	if(cfg.bundle_cache_file != "" && index == 0) cache.open_write();
+
+	// virtual offset of the next read in the BAM file, -1 if 
+	// unknown (before the first read and for replayed reads)
+	bool ckpt = checkpoint_enabled();
+	int64_t voff = -1;
+
+	int sample = 0;
+	bam1_t *b = NULL;
+	while((b = reader.read(sample)) != NULL)
 	{
 		if(terminate == true) return 0;
 
-		bam1_core_t &p = b1t->core;
+		int64_t roff = voff;
+		if(ckpt == true) voff = reader.replayed() ? -1 : bgzf_tell(reader.file(0)->fp.bgzf);
 
-		if((p.flag & 0x4) >= 1) continue;										// read is not mapped
-		if((p.flag & 0x100) >= 1 && use_second_alignment == false) continue;	// secondary alignment
-		if(p.n_cigar > MAX_NUM_CIGAR) continue;									// ignore hits with more than 7 cigar types
-		if(p.qual < min_mapping_quality) continue;								// ignore hits with small quality
-		if(p.n_cigar < 1) continue;												// should never happen
+		if(accept(b->core) == false) continue;
 
-		hit ht(b1t);
-		ht.set_tags(b1t);
-		ht.set_strand();
-		ht.build_splice_positions();
+		hit ht(b, cfg);
+		ht.set_tags(b);
+		ht.set_strand(cfg);
+		ht.sample = sample;
 
 		//ht.print();
 
-		//if(ht.nh >= 2 && p.qual < min_mapping_quality) continue;
-		//if(ht.nm > max_edit_distance) continue;
+		// both bundles are closed by this read: every read before it 
+		// is in a closed bundle, so a checkpoint can be taken here
+		bool closed = closes_bundles(ht);
 
-		qlen += ht.qlen;
-		qcnt += 1;
+		add_hit(ht);
 
-		// truncate
-		if(ht.tid != bb1.tid || ht.pos > bb1.rpos + min_bundle_gap)
-		{
-			pool.push_back(bb1);
-			bb1.clear();
-		}
-		if(ht.tid != bb2.tid || ht.pos > bb2.rpos + min_bundle_gap)
+		if(ckpt == true && roff >= 0 && closed == true) checkpoint(roff, qlen - ht.qlen, qcnt - 1);
+	}
+	return 0;
+}
+
+int assembler::replay_cache()
+{
+	if(cfg.verbose >= 1) printf("bundle cache: reading bundles from %s instead of the input\n", cfg.bundle_cache_file.c_str());
+
+	// bundles are processed in the order they were saved, so
+	// that genes are numbered as in the run writing the cache
+	bundle_base bb(&cfg);
+	bundle bd(bb);
+	bool built = false;
+	while(terminate == false && cache.read(bd, built) == 0)
+	{
+		if(built == true)
 		{
-			pool.push_back(bb2);
-			bb2.clear();
+			process(0);
+			process_built(bd);
+			continue;
 		}
 
-		// process
-		process(batch_bundle_size);
+		// built again from its hits with the options of this run
+		pool_bytes += bd.memory_usage();
+		pool.push_back(std::move(bd));
+		process(cfg.batch_bundle_size);
+		check_memory();
+	}
+
+	if(cfg.verbose >= 1) printf("bundle cache: %d bundles read, %d of them with saved splice graphs\n", cache.num_bundles, cache.num_graphs);
+
+	qlen = cache.qlen;
+	qcnt = cache.qcnt;
+	return 0;
+}
+
+int assembler::process_built(bundle &bd)
+{
+	// the splice graph and hyper-set were read from the bundle cache
+	bd.chrm = bd.tid < chrms.size() ? chrms[bd.tid] : tostring(bd.tid);
+	dog.start(cfg.max_bundle_seconds, cfg.max_bundle_memory);
+	bd.guard = &dog;
+
+	printf("Bundle %d: tid = %d, #hits = %d, range = %s:%d-%d, orient = %c, splice graph read from bundle cache\n", 
+			index, bd.tid, bd.num_reads, bd.chrm.c_str(), bd.lpos, bd.rpos, bd.strand);
+
+	int n0 = trsts.size();
+	if(assemble(std::move(bd.gr), std::move(bd.hs), cfg, trsts) != 0) quarantine(bd);
+	else if(cfg.sample_coverage == true) assign_samples(bd, trsts, n0);
+	index++;
+	return 0;
+}
+
+bool assembler::accept(const bam1_core_t &p) const
+{
+	if((p.flag & 0x4) >= 1) return false;										// read is not mapped
+	if((p.flag & 0x100) >= 1 && cfg.use_second_alignment == false) return false;	// secondary alignment
+	if(p.n_cigar > MAX_NUM_CIGAR) return false;									// ignore hits with more than 7 cigar types
+	if(p.qual < cfg.min_mapping_quality) return false;							// ignore hits with small quality
+	if(p.n_cigar < 1) return false;												// should never happen
+	return true;
+}
 
-		//printf("read strand = %c, xs = %c, ts = %c\n", ht.strand, ht.xs, ht.ts);
+bool assembler::closes_bundles(const hit &ht) const
+{
+	if(ht.tid == bb1.tid && ht.pos <= bb1.rpos + cfg.min_bundle_gap) return false;
+	if(ht.tid == bb2.tid && ht.pos <= bb2.rpos + cfg.min_bundle_gap) return false;
+	return true;
+}
 
-		// add hit
-		if(uniquely_mapped_only == true && ht.nh != 1) continue;
-		if(library_type != UNSTRANDED && ht.strand == '+' && ht.xs == '-') continue;
-		if(library_type != UNSTRANDED && ht.strand == '-' && ht.xs == '+') continue;
-		if(library_type != UNSTRANDED && ht.strand == '.' && ht.xs != '.') ht.strand = ht.xs;
-		if(library_type != UNSTRANDED && ht.strand == '+') bb1.add_hit(ht);
-		if(library_type != UNSTRANDED && ht.strand == '-') bb2.add_hit(ht);
-		if(library_type == UNSTRANDED && ht.xs == '.') bb1.add_hit(ht);
-		if(library_type == UNSTRANDED && ht.xs == '.') bb2.add_hit(ht);
-		if(library_type == UNSTRANDED && ht.xs == '+') bb1.add_hit(ht);
-		if(library_type == UNSTRANDED && ht.xs == '-') bb2.add_hit(ht);
+int assembler::add_hit(hit &ht)
+{
+	if(terminate == true) return 0;
+	if(accept(ht) == false) return 0;
+
+	//if(ht.nh >= 2 && p.qual < cfg.min_mapping_quality) continue;
+	//if(ht.nm > cfg.max_edit_distance) continue;
+
+	qlen += ht.qlen;
+	qcnt += 1;
+
+	// truncate
+	if(ht.tid != bb1.tid || ht.pos > bb1.rpos + cfg.min_bundle_gap)
+	{
+		pool_bytes += bb1.memory_usage();
+		pool.push_back(std::move(bb1));
+		bb1.clear();
+	}
+	if(ht.tid != bb2.tid || ht.pos > bb2.rpos + cfg.min_bundle_gap)
+	{
+		pool_bytes += bb2.memory_usage();
+		pool.push_back(std::move(bb2));
+		bb2.clear();
 	}
 
-	pool.push_back(bb1);
-	pool.push_back(bb2);
+	// process
+	process(cfg.batch_bundle_size);
+
+	//printf("read strand = %c, xs = %c, ts = %c\n", ht.strand, ht.xs, ht.ts);
+
+	// add hit
+	if(cfg.uniquely_mapped_only == true && ht.nh != 1) return 0;
+	if(cfg.library_type != UNSTRANDED && ht.strand == '+' && ht.xs == '-') return 0;
+	if(cfg.library_type != UNSTRANDED && ht.strand == '-' && ht.xs == '+') return 0;
+	if(cfg.library_type != UNSTRANDED && ht.strand == '.' && ht.xs != '.') ht.strand = ht.xs;
+	if(cfg.library_type != UNSTRANDED && ht.strand == '+') bb1.add_hit(ht);
+	if(cfg.library_type != UNSTRANDED && ht.strand == '-') bb2.add_hit(ht);
+	if(cfg.library_type == UNSTRANDED && ht.xs == '.') bb1.add_hit(ht);
+	if(cfg.library_type == UNSTRANDED && ht.xs == '.') bb2.add_hit(ht);
+	if(cfg.library_type == UNSTRANDED && ht.xs == '+') bb1.add_hit(ht);
+	if(cfg.library_type == UNSTRANDED && ht.xs == '-') bb2.add_hit(ht);
+
+	check_memory();
+	return 0;
+}
+
+int assembler::add_bundle(bundle_base &&bb)
+{
+	if(terminate == true) return 0;
+	bb.cfg = &cfg;
+	for(int i = 0; i < bb.hits.size(); i++) qlen += bb.hits[i].qlen * bb.hits[i].weight;
+	qcnt += bb.num_reads;
+	pool_bytes += bb.memory_usage();
+	pool.push_back(std::move(bb));
+	process(cfg.batch_bundle_size);
+	return 0;
+}
+
+int assembler::finish()
+{
+	pool.push_back(std::move(bb1));
+	pool.push_back(std::move(bb2));
+	bb1.clear();
+	bb2.clear();
 	process(0);
 
-	assign_RPKM();
+	assign_RPKM(trsts);
 
-	filter ft(trsts);
+	filter ft(trsts, cfg);
 	ft.merge_single_exon_transcripts();
 	trsts = ft.trs;
 
-	write();
-	
+	for(int i = 0; i < sweeps.size(); i++)
+	{
+		assign_RPKM(strsts[i]);
+		filter fs(strsts[i], sweeps[i]);
+		fs.merge_single_exon_transcripts();
+		strsts[i] = fs.trs;
+	}
 	return 0;
 }
 
@@ -117,76 +283,451 @@ int assembler::process(int n)
 
 		//printf("bundle %d has %lu reads\n", i, bb.hits.size());
 
-		if(bb.hits.size() < min_num_hits_in_bundle) continue;
-		if(bb.tid < 0) continue;
+		if(bb.num_reads < cfg.min_num_hits_in_bundle || bb.tid < 0)
+		{
+			bb.remove_spill();
+			continue;
+		}
 
-		char buf[1024];
-		strcpy(buf, hdr->target_name[bb.tid]);
+		bb.downsample();
 
-		bundle bd(bb);
+		if(cfg.bundle_cache_file != "")
+		{
+			bb.restore();
+			cache.write_hits(bb);
+		}
+
+		string chrm = bb.tid < chrms.size() ? chrms[bb.tid] : tostring(bb.tid);
 
-		bd.chrm = string(buf);
-		bd.build();
+		if(sweeps.size() >= 1)
+		{
+			process_sweep(bb, chrm);
+			index++;
+			continue;
+		}
+
+		bundle bd(std::move(bb));
+
+		bd.chrm = chrm;
+		dog.start(cfg.max_bundle_seconds, cfg.max_bundle_memory);
+		bd.guard = &dog;
+
+		if(bd.build() != 0)
+		{
+			cache.write_graph(NULL);
+			quarantine(bd);
+			index++;
+			continue;
+		}
+
+		cache.write_graph(&bd);
 		bd.print(index);
 
-		//if(verbose >= 1) bd.print(index);
+		//if(cfg.verbose >= 1) bd.print(index);
 
-		assemble(bd.gr, bd.hs);
+		int n0 = trsts.size();
+		if(assemble(std::move(bd.gr), std::move(bd.hs), cfg, trsts) != 0) quarantine(bd);
+		else if(cfg.sample_coverage == true) assign_samples(bd, trsts, n0);
 		index++;
 	}
 	pool.clear();
+	pool_bytes = 0;
 	return 0;
 }
 
-int assembler::assemble(const splice_graph &gr0, const hyper_set &hs0)
+int assembler::process_sweep(bundle_base &bb, const string &chrm)
 {
-	super_graph sg(gr0, hs0);
-	sg.build();
+	// settings agreeing on the options of bundle::build share one
+	// built bundle; the graph is then decomposed once per setting
+	int n = sweeps.size();
+	vector<int> groups(n, -1);
+	for(int i = 0; i < n; i++)
+	{
+		for(int j = 0; j < i && groups[i] == -1; j++)
+		{
+			if(groups[j] == j && sweeps[i].same_bundle(sweeps[j])) groups[i] = j;
+		}
+		if(groups[i] == -1) groups[i] = i;
+	}
 
-	vector<transcript> gv;
-	for(int k = 0; k < sg.subs.size(); k++)
+	// every copy below needs the hits in memory
+	bb.restore();
+
+	dog.start(cfg.max_bundle_seconds, cfg.max_bundle_memory);
+	bool quarantined = false;
+	bool saved = false;
+	for(int g = 0; g < n; g++)
 	{
-		string gid = "gene." + tostring(index) + "." + tostring(k);
-		if(fixed_gene_name != "" && gid != fixed_gene_name) continue;
+		if(groups[g] != g) continue;
+
+		bundle bd(bb);
+		bd.cfg = &sweeps[g];
+		bd.chrm = chrm;
+		bd.guard = &dog;
+
+		int r = bd.build();
+		if(r == 0 && g == 0) bd.print(index);
+
+		// the bundle cache keeps the graph built with the base options
+		if(saved == false && sweeps[g].same_bundle(cfg) == true)
+		{
+			cache.write_graph(r == 0 ? &bd : NULL);
+			saved = true;
+		}
 
-		if(verbose >= 2 && (k == 0 || fixed_gene_name != "")) sg.print();
+		vector<int> vs;
+		for(int i = 0; i < n; i++) if(groups[i] == g) vs.push_back(i);
 
-		splice_graph &gr = sg.subs[k];
-		hyper_set &hs = sg.hss[k];
+		vector< vector<transcript> > vv(vs.size());
+		vector<int> rr(vs.size(), 0);
+		if(r == 0) workers.run(vs.size(), [&](int j)
+		{
+			rr[j] = assemble(splice_graph(bd.gr), hyper_set(bd.hs), sweeps[vs[j]], vv[j]);
+		});
+		for(int j = 0; j < vs.size(); j++) if(rr[j] != 0) r = -1;
 
-		gr.gid = gid;
-		scallop sc(gr, hs);
-		sc.assemble();
+		if(r != 0)
+		{
+			if(quarantined == false) quarantine(bd);
+			quarantined = true;
+			continue;
+		}
 
-		if(verbose >= 2)
+		for(int j = 0; j < vs.size(); j++)
 		{
-			printf("transcripts:\n");
-			for(int i = 0; i < sc.trsts.size(); i++) sc.trsts[i].write(cout);
+			vector<transcript> &v = strsts[vs[j]];
+			int n0 = v.size();
+			v.insert(v.end(), vv[j].begin(), vv[j].end());
+			if(sweeps[vs[j]].sample_coverage == true) assign_samples(bd, v, n0);
 		}
+	}
+
+	if(saved == false) cache.write_graph(NULL);
+	return 0;
+}
+
+int assembler::check_memory()
+{
+	if(cfg.max_memory <= 0) return 0;
+
+	int64_t budget = (int64_t)(cfg.max_memory * 1048576.0);
+	if(pool_bytes + bb1.memory_usage() + bb2.memory_usage() <= budget) return 0;
+
+	// assemble closed bundles first
+	if(pool.size() >= 1) process(0);
+	if(bb1.memory_usage() + bb2.memory_usage() <= budget) return 0;
 
-		filter ft(sc.trsts);
-		ft.join_single_exon_transcripts();
-		ft.filter_length_coverage();
-		if(ft.trs.size() >= 1) gv.insert(gv.end(), ft.trs.begin(), ft.trs.end());
+	// open bundles are capped by downsampling then,
+	// and spilling their hits would break the sample
+	if(cfg.max_hits_in_bundle > 0) return 0;
 
-		if(verbose >= 2)
+	// spill hits of the larger open bundle; small batches are
+	// kept in memory as the interval maps dominate then
+	bundle_base &bb = (bb1.hit_bytes >= bb2.hit_bytes) ? bb1 : bb2;
+	if(bb.hit_bytes < budget / 16) return 0;
+
+	if(bb.spill_file == "") bb.spill_file = cfg.output_file + ".spill." + tostring(spill_index++);
+	if(cfg.verbose >= 2) printf("spill %lu hits of bundle %s:%d-%d to %s\n", bb.hits.size(), bb.tid < chrms.size() ? chrms[bb.tid].c_str() : "", bb.lpos, bb.rpos, bb.spill_file.c_str());
+	bb.spill();
+
+	return 0;
+}
+
+int assembler::quarantine(const bundle &bd)
+{
+	num_quarantined++;
+	num_quarantined_hits += bd.num_reads;
+
+	if(cfg.verbose >= 1) printf("Bundle %d: aborted by %s limit after %.2lf seconds, range = %s:%d-%d, #hits = %d, quarantined\n", 
+			index, dog.reason_string().c_str(), dog.elapsed(), bd.chrm.c_str(), bd.lpos, bd.rpos, bd.num_reads);
+
+	if(qout.is_open() == false)
+	{
+		string file = cfg.quarantine_file;
+		if(file == "") file = cfg.output_file + ".quarantine.tsv";
+		// a resumed run keeps the bundles quarantined before
+		if(cfg.resume == true) qout.open(file.c_str(), ios::app);
+		else qout.open(file.c_str());
+		if(qout.fail()) return 0;
+		if(qout.tellp() == 0) qout << "#chrm\tlpos\trpos\tstrand\thits\treason\tseconds\n";
+	}
+
+	char buf[1024];
+	sprintf(buf, "%s\t%d\t%d\t%c\t%d\t%s\t%.2lf\n", bd.chrm.c_str(), bd.lpos, bd.rpos, bd.strand, bd.num_reads, dog.reason_string().c_str(), dog.elapsed());
+	qout << buf;
+	qout.flush();
+
+	return 0;
+}
+
+bool assembler::checkpoint_enabled() const
+{
+	if(cfg.checkpoint_interval <= 0) return false;
+	if(sweeps.size() >= 1) return false;
+	if(cfg.regions_file != "") return false;
+	if(reader.size() != 1) return false;
+	if(reader.file(0)->format.format != bam) return false;
+	return true;
+}
+
+int assembler::checkpoint(int64_t offset, double ql, int qc)
+{
+	chrono::duration<double> d = chrono::steady_clock::now() - last_checkpoint;
+	if(d.count() < cfg.checkpoint_interval) return 0;
+
+	process(0);
+	if(terminate == true) return 0;
+
+	write_checkpoint(offset, ql, qc);
+	last_checkpoint = chrono::steady_clock::now();
+	return 0;
+}
+
+int assembler::write_checkpoint(int64_t offset, double ql, int qc)
+{
+	// write to a temporary file and rename, so that 
+	// a crash never leaves a truncated checkpoint
+	string tmp = checkpoint_file + ".tmp";
+	FILE *f = fopen(tmp.c_str(), "w");
+	if(f == NULL)
+	{
+		printf("open checkpoint file %s error\n", tmp.c_str());
+		return -1;
+	}
+
+	fprintf(f, "scallop-checkpoint 1\n");
+	fprintf(f, "input %s\n", cfg.input_file.c_str());
+	fprintf(f, "offset %lld\n", (long long)offset);
+	fprintf(f, "qlen %.17g\n", ql);
+	fprintf(f, "qcnt %d\n", qc);
+	fprintf(f, "index %d\n", index);
+	fprintf(f, "transcripts %lu\n", trsts.size());
+	for(int i = 0; i < trsts.size(); i++)
+	{
+		const transcript &t = trsts[i];
+		fprintf(f, "%s %s %s %s %c %.17g %lu", t.seqname.c_str(), t.source.c_str(), t.gene_id.c_str(), t.transcript_id.c_str(), t.strand, t.coverage, t.exons.size());
+		for(int k = 0; k < t.exons.size(); k++) fprintf(f, " %d %d", t.exons[k].first, t.exons[k].second);
+		fprintf(f, " %lu", t.samples.size());
+		for(int k = 0; k < t.samples.size(); k++) fprintf(f, " %.17g", t.samples[k]);
+		fprintf(f, "\n");
+	}
+
+	bool b = (ferror(f) == 0);
+	if(fclose(f) != 0) b = false;
+	if(b == false || rename(tmp.c_str(), checkpoint_file.c_str()) != 0)
+	{
+		printf("write checkpoint file %s error\n", checkpoint_file.c_str());
+		remove(tmp.c_str());
+		return -1;
+	}
+
+	if(cfg.verbose >= 1) printf("checkpoint: %d bundles, %lu transcripts, %d reads, saved to %s\n", index, trsts.size(), qc, checkpoint_file.c_str());
+	return 0;
+}
+
+int assembler::read_checkpoint()
+{
+	ifstream fin(checkpoint_file.c_str());
+	if(fin.fail())
+	{
+		printf("checkpoint file %s does not exist, start from the beginning\n", checkpoint_file.c_str());
+		return 0;
+	}
+
+	if(reader.size() != 1 || reader.file(0)->format.format != bam)
+	{
+		printf("resuming is only supported for a single BAM file, start from the beginning\n");
+		return 0;
+	}
+
+	string s, file;
+	int version = 0;
+	long long offset = -1;
+	double ql = 0;
+	int qc = 0, k = 0, n = 0;
+	fin >> s >> version;
+	if(s != "scallop-checkpoint" || version != 1)
+	{
+		printf("checkpoint file %s is corrupted, start from the beginning\n", checkpoint_file.c_str());
+		return 0;
+	}
+
+	fin >> s >> file >> s >> offset >> s >> ql >> s >> qc >> s >> k >> s >> n;
+	if(fin.fail() || file != cfg.input_file || offset < 0)
+	{
+		printf("checkpoint file %s does not match input %s, start from the beginning\n", checkpoint_file.c_str(), cfg.input_file.c_str());
+		return 0;
+	}
+
+	vector<transcript> v(n);
+	for(int i = 0; i < n; i++)
+	{
+		transcript &t = v[i];
+		int m = 0;
+		fin >> t.seqname >> t.source >> t.gene_id >> t.transcript_id >> t.strand >> t.coverage >> m;
+		for(int j = 0; j < m; j++)
 		{
-			printf("transcripts after filtering:\n");
-			for(int i = 0; i < ft.trs.size(); i++) ft.trs[i].write(cout);
+			int32_t p1, p2;
+			fin >> p1 >> p2;
+			t.add_exon(p1, p2);
 		}
+		fin >> m;
+		t.samples.resize(m < 0 ? 0 : m);
+		for(int j = 0; j < t.samples.size(); j++) fin >> t.samples[j];
+		t.feature = "transcript";
+	}
 
-		if(fixed_gene_name != "" && gid == fixed_gene_name) terminate = true;
-		if(terminate == true) return 0;
+	if(fin.fail() || reader.seek(offset) != 0)
+	{
+		printf("checkpoint file %s is corrupted, start from the beginning\n", checkpoint_file.c_str());
+		return 0;
+	}
+
+	trsts = v;
+	qlen = ql;
+	qcnt = qc;
+	index = k;
+	printf("resume from checkpoint %s: %d bundles, %lu transcripts, %d reads\n", checkpoint_file.c_str(), index, trsts.size(), qcnt);
+	return 0;
+}
+
+int assembler::assemble(splice_graph &&gr0, hyper_set &&hs0, const parameters &c, vector<transcript> &out)
+{
+	super_graph sg(std::move(gr0), std::move(hs0));
+	sg.build();
+
+	// subgraphs are independent; results are collected in k order
+	int n = sg.subs.size();
+	vector< vector<transcript> > vv(n);
+	vector<int> rr(n, 0);
+	if(c.verbose >= 2 || c.fixed_gene_name != "")
+	{
+		for(int k = 0; k < n; k++)
+		{
+			rr[k] = assemble(sg, k, c, vv[k]);
+			if(rr[k] != 0) return -1;
+
+			string gid = "gene." + tostring(index) + "." + tostring(k);
+			if(c.fixed_gene_name != "" && gid == c.fixed_gene_name) terminate = true;
+			if(terminate == true) return 0;
+		}
+	}
+	else
+	{
+		workers.run(n, [&](int k) { rr[k] = assemble(sg, k, c, vv[k]); });
+	}
+
+	// an aborted subgraph discards the whole bundle
+	for(int k = 0; k < n; k++)
+	{
+		if(rr[k] != 0) return -1;
 	}
 
-	filter ft(gv);
+	vector<transcript> gv;
+	for(int k = 0; k < n; k++)
+	{
+		if(vv[k].size() >= 1) gv.insert(gv.end(), vv[k].begin(), vv[k].end());
+	}
+
+	filter ft(gv, c);
 	ft.remove_nested_transcripts();
-	if(ft.trs.size() >= 1) trsts.insert(trsts.end(), ft.trs.begin(), ft.trs.end());
+	if(ft.trs.size() >= 1) out.insert(out.end(), ft.trs.begin(), ft.trs.end());
+
+	return 0;
+}
+
+int assembler::assemble(super_graph &sg, int k, const parameters &c, vector<transcript> &v)
+{
+	string gid = "gene." + tostring(index) + "." + tostring(k);
+	if(c.fixed_gene_name != "" && gid != c.fixed_gene_name) return 0;
+
+	if(c.verbose >= 2 && (k == 0 || c.fixed_gene_name != "")) sg.print();
+
+	// the subgraph is handed over to scallop
+	sg.subs[k].gid = gid;
+	scallop sc(std::move(sg.subs[k]), std::move(sg.hss[k]), c);
+	sc.guard = &dog;
+	sc.assemble();
+	if(sc.budget_exceeded == true) num_budget_graphs++;
+	if(sc.aborted == true) return -1;
+
+	if(c.verbose >= 2)
+	{
+		printf("transcripts:\n");
+		for(int i = 0; i < sc.trsts.size(); i++) sc.trsts[i].write(cout);
+	}
+
+	filter ft(sc.trsts, c);
+	ft.join_single_exon_transcripts();
+	ft.filter_length_coverage();
+	v = ft.trs;
+
+	if(c.verbose >= 2)
+	{
+		printf("transcripts after filtering:\n");
+		for(int i = 0; i < ft.trs.size(); i++) ft.trs[i].write(cout);
+	}
+
+	return 0;
+}
+
+int assembler::assign_samples(const bundle &bd, vector<transcript> &trsts, int n0)
+{
+	if(n0 >= trsts.size()) return 0;
 
+	// hits ordered by position; a compatible hit starts inside the transcript
+	vector<PI32> v;
+	for(int i = 0; i < bd.hits.size(); i++) v.push_back(PI32(bd.hits[i].pos, i));
+	sort(v.begin(), v.end());
+
+	int n = reader.size();
+	for(int i = 0; i < bd.hits.size(); i++) if(bd.hits[i].sample >= n) n = bd.hits[i].sample + 1;
+	for(int i = n0; i < trsts.size(); i++)
+	{
+		transcript &t = trsts[i];
+		PI32 p = t.get_bounds();
+		vector<double> c(n, 0);
+		double sum = 0;
+
+		vector<PI32>::iterator it = lower_bound(v.begin(), v.end(), PI32(p.first, -1));
+		for(; it != v.end() && it->first < p.second; it++)
+		{
+			const hit &h = bd.hits[it->second];
+			if(h.rpos > p.second) continue;
+
+			// every aligned block lies in an exon, and blocks in different
+			// exons are spliced exactly at consecutive exons, so that a
+			// read skipping an exon of the transcript is not counted
+			bool b = true;
+			int e = 0, e0 = -1;
+			int32_t q0 = -1;
+			for(int k = 0; k < h.n_matched && b == true; k++)
+			{
+				int32_t p1 = high32(h.itvs[k]);
+				int32_t p2 = low32(h.itvs[k]);
+				while(e < t.exons.size() && t.exons[e].second < p2) e++;
+				if(e >= t.exons.size() || t.exons[e].first > p1) b = false;
+				else if(e0 >= 0 && e != e0)
+				{
+					if(e != e0 + 1 || q0 != t.exons[e0].second || p1 != t.exons[e].first) b = false;
+				}
+				e0 = e;
+				q0 = p2;
+			}
+			if(b == false) continue;
+
+			c[h.sample] += h.weight;
+			sum += h.weight;
+		}
+
+		t.samples.assign(n, 0);
+		if(sum <= 0) continue;
+		for(int k = 0; k < n; k++) t.samples[k] = t.coverage * c[k] / sum;
+	}
 	return 0;
 }
 
-int assembler::assign_RPKM()
+int assembler::assign_RPKM(vector<transcript> &trsts)
 {
 	double factor = 1e9 / qlen;
 	for(int i = 0; i < trsts.size(); i++)
@@ -196,13 +737,13 @@ int assembler::assign_RPKM()
 	return 0;
 }
 
-int assembler::write()
+int assembler::write(const vector<transcript> &trsts, const string &file)
 {
-	ofstream fout(output_file.c_str());
+	ofstream fout(file.c_str());
 	if(fout.fail()) return 0;
 	for(int i = 0; i < trsts.size(); i++)
 	{
-		transcript &t = trsts[i];
+		const transcript &t = trsts[i];
 		t.write(fout);
 	}
 	fout.close();
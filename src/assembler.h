@@ -9,41 +9,85 @@ See LICENSE for licensing.
 
 #include <fstream>
 #include <string>
+#include <atomic>
+#include <chrono>
 #include "bundle_base.h"
 #include "bundle.h"
 #include "transcript.h"
 #include "splice_graph.h"
+#include "super_graph.h"
+#include "thread_pool.h"
+#include "watchdog.h"
+#include "bam_merger.h"
+#include "previewer.h"
+#include "bundle_cache.h"
 
 using namespace std;
 
+// assembles the input files given in parameters, or hits and
+// bundles passed in memory (add_hit/add_bundle, then finish)
 class assembler
 {
 public:
-	assembler();
+	assembler(const parameters &_cfg, previewer &pv);
+	assembler(const parameters &_cfg, const vector<string> &_chrms);
 	~assembler();
 
+public:
+	vector<transcript> trsts;	// assembled transcripts
+
 private:
-	samFile *sfn;
-	bam_hdr_t *hdr;
-	bam1_t *b1t;
+	parameters cfg;			// private copy, referred to by bundles
 	bundle_base bb1;		// +
 	bundle_base bb2;		// -
 	vector<bundle_base> pool;
+	int64_t pool_bytes;		// estimated bytes held by pool
+	int spill_index;		// index of next spill file
+	thread_pool workers;	// workers for assembling subgraphs
+	watchdog dog;			// ceilings for the bundle being processed
+	ofstream qout;			// quarantined bundles
+	int num_quarantined;	// number of quarantined bundles
+	int64_t num_quarantined_hits;
+	string checkpoint_file;	// completed transcripts and input offset
+	chrono::steady_clock::time_point last_checkpoint;
+	bundle_cache cache;		// bundles saved for, or read from, another run
 
 	int index;
 	bool terminate;
 	int qcnt;
 	double qlen;
-	vector<transcript> trsts;
+	bam_merger reader;		// merged stream of all input files
+	vector<string> chrms;	// chromosome names, indexed by tid
+	vector<parameters> sweeps;				// settings of a parameter sweep, empty if none
+	vector< vector<transcript> > strsts;	// transcripts of each sweep setting
+	atomic<int> num_budget_graphs;	// graphs whose decomposing exceeded the budget
 
 public:
 	int assemble();
+	int add_hit(hit &ht);
+	int add_bundle(bundle_base &&bb);
+	int finish();
 
 private:
+	int init();
+	int read_inputs();
+	int replay_cache();
+	int process_built(bundle &bd);
+	bool accept(const bam1_core_t &p) const;
+	bool closes_bundles(const hit &ht) const;
 	int process(int n);
-	int assemble(const splice_graph &gr, const hyper_set &hs);
-	int assign_RPKM();
-	int write();
+	int process_sweep(bundle_base &bb, const string &chrm);
+	int check_memory();
+	int quarantine(const bundle &bd);
+	bool checkpoint_enabled() const;
+	int checkpoint(int64_t offset, double ql, int qc);
+	int write_checkpoint(int64_t offset, double ql, int qc);
+	int read_checkpoint();
+	int assemble(splice_graph &&gr, hyper_set &&hs, const parameters &c, vector<transcript> &out);
+	int assemble(super_graph &sg, int k, const parameters &c, vector<transcript> &v);
+	int assign_samples(const bundle &bd, vector<transcript> &trsts, int n0);
+	int assign_RPKM(vector<transcript> &trsts);
+	int write(const vector<transcript> &trsts, const string &file);
 	int compare(splice_graph &gr, const string &ref, const string &tex = "");
 };
 
@@ -0,0 +1,401 @@
+/*
+Part of Scallop Transcript Assembler
+(c) 2017 by  Mingfu Shao, Carl Kingsford, and Carnegie Mellon University.
+See LICENSE for licensing.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <climits>
+#include <cassert>
+#include <fstream>
+#include <sstream>
+
+#include "bam_merger.h"
+
+bam_merger::bam_merger()
+{
+	last = -1;
+	nreplay = 0;
+	from_replay = false;
+	num_dropped = 0;
+	nregion = 0;
+	gap = 0;
+	qtid = -1;
+	qbeg = qend = qmax = 0;
+}
+
+bam_merger::~bam_merger()
+{
+	if(num_dropped >= 1) printf("%lld reads on chromosomes missing in the first input were ignored\n", (long long)num_dropped);
+
+	for(int i = nreplay; i < replay.size(); i++) bam_destroy1(replay[i]);
+	for(int i = 0; i < itrs.size(); i++) if(itrs[i] != NULL) hts_itr_destroy(itrs[i]);
+	for(int i = 0; i < idxs.size(); i++) if(idxs[i] != NULL) hts_idx_destroy(idxs[i]);
+	for(int i = 0; i < bufs.size(); i++) bam_destroy1(bufs[i]);
+	for(int i = 0; i < hdrs.size(); i++) bam_hdr_destroy(hdrs[i]);
+	for(int i = 0; i < sfns.size(); i++) sam_close(sfns[i]);
+}
+
+int bam_merger::adopt(samFile *fn, bam_hdr_t *h, vector<bam1_t*> &v)
+{
+	// takes over the first file, already opened and partly
+	// read by the previewer; its records v come first
+	assert(sfns.size() == 0);
+	sfns.push_back(fn);
+	hdrs.push_back(h);
+	bufs.push_back(bam_init1());
+	replay = v;
+	nreplay = 0;
+	return 0;
+}
+
+int bam_merger::open(const vector<string> &files)
+{
+	for(int k = sfns.size(); k < files.size(); k++)
+	{
+		samFile *fn = sam_open(files[k].c_str(), "r");
+		if(fn == NULL)
+		{
+			printf("open input file %s error\n", files[k].c_str());
+			exit(1);
+		}
+		project_fields(fn);
+		sfns.push_back(fn);
+		hdrs.push_back(sam_hdr_read(fn));
+		bufs.push_back(bam_init1());
+	}
+
+	// translate chromosome ids by name
+	tmaps.resize(files.size());
+	for(int k = 0; k < files.size(); k++)
+	{
+		bam_hdr_t *h = hdrs[k];
+		tmaps[k].assign(h->n_targets, -1);
+		for(int i = 0; i < h->n_targets; i++)
+		{
+			if(k == 0) tmaps[k][i] = i;
+			else tmaps[k][i] = bam_name2id(hdrs[0], h->target_name[i]);
+		}
+	}
+
+	for(int k = 0; k < files.size(); k++) fetch(k);
+	return 0;
+}
+
+int bam_merger::size() const
+{
+	return sfns.size();
+}
+
+samFile* bam_merger::file(int k) const
+{
+	assert(k >= 0 && k < sfns.size());
+	return sfns[k];
+}
+
+int bam_merger::seek(int64_t offset)
+{
+	// restart the single input at a virtual offset
+	assert(sfns.size() == 1);
+	for(int i = nreplay; i < replay.size(); i++) bam_destroy1(replay[i]);
+	replay.clear();
+	nreplay = 0;
+	heap.clear();
+	last = -1;
+
+	if(bgzf_seek(sfns[0]->fp.bgzf, offset, SEEK_SET) < 0) return -1;
+	fetch(0);
+	return 0;
+}
+
+int bam_merger::set_regions(const string &file, int min_gap)
+{
+	// regions are padded by min_gap and merged, so that nearby
+	// regions are read once; the bundles reaching a region are
+	// read in full, see next_query
+	if(load_index() != 0)
+	{
+		printf("error: --regions requires indexed input files\n");
+		exit(1);
+	}
+
+	ifstream fin(file.c_str());
+	if(fin.fail())
+	{
+		printf("open regions file %s error\n", file.c_str());
+		exit(1);
+	}
+
+	gap = min_gap;
+	vector< pair<int64_t, int32_t> > v;		// (tid << 32 | begin, end)
+	string line;
+	int skipped = 0;
+	while(getline(fin, line))
+	{
+		if(line == "" || line[0] == '#') continue;
+		if(line.substr(0, 5) == "track" || line.substr(0, 7) == "browser") continue;
+
+		stringstream sstr(line);
+		string chrm;
+		int64_t b, e;
+		sstr >> chrm >> b >> e;
+		int32_t tid = bam_name2id(hdrs[0], chrm.c_str());
+		if(sstr.fail() || tid < 0 || e <= b)
+		{
+			skipped++;
+			continue;
+		}
+
+		b -= gap;
+		e += gap;
+		if(b < 0) b = 0;
+		if(e > hdrs[0]->target_len[tid]) e = hdrs[0]->target_len[tid];
+		v.push_back(pair<int64_t, int32_t>(((int64_t)(tid) << 32) | b, e));
+	}
+	fin.close();
+
+	if(skipped >= 1) printf("%d lines of regions file %s were ignored\n", skipped, file.c_str());
+
+	sort(v.begin(), v.end());
+	for(int i = 0; i < v.size(); i++)
+	{
+		int32_t tid = v[i].first >> 32;
+		int32_t b = v[i].first & 0xffffffff;
+		int32_t e = v[i].second;
+		if(rtids.size() >= 1 && rtids.back() == tid && b <= rends.back())
+		{
+			if(e > rends.back()) rends.back() = e;
+			continue;
+		}
+		rtids.push_back(tid);
+		rbegs.push_back(b);
+		rends.push_back(e);
+	}
+
+	// records read before by the previewer are not needed
+	for(int i = nreplay; i < replay.size(); i++) bam_destroy1(replay[i]);
+	replay.clear();
+	nreplay = 0;
+	heap.clear();
+	last = -1;
+	itrs.assign(sfns.size(), NULL);
+	nregion = 0;
+	qtid = -1;
+	return rtids.size();
+}
+
+int bam_merger::load_index()
+{
+	for(int k = idxs.size(); k < sfns.size(); k++)
+	{
+		idxs.push_back(sam_index_load(sfns[k], sfns[k]->fn));
+		if(idxs[k] == NULL) return -1;
+	}
+	return 0;
+}
+
+int bam_merger::next_query()
+{
+	// return 0 if another query is started, -1 if regions are done
+	if(itrs.size() == 0) return -1;
+
+	// a bundle may go on past the end of the query: read on
+	// to the right until no read reaches beyond the gap
+	if(qtid >= 0 && qmax + gap >= qend) return query(qtid, qend, qmax + gap + 1);
+
+	while(nregion < rtids.size())
+	{
+		int32_t tid = rtids[nregion];
+		int32_t b = rbegs[nregion];
+		int32_t e = rends[nregion];
+		nregion++;
+
+		// the region may have been covered by extending the previous one
+		int32_t lo = (tid == qtid) ? qend : 0;
+		if(b < lo) b = lo;
+		if(e <= b) continue;
+
+		qmax = 0;
+		return query(tid, extend_left(tid, b, lo), e);
+	}
+	return -1;
+}
+
+int bam_merger::query(int32_t tid, int32_t beg, int32_t end)
+{
+	qtid = tid;
+	qbeg = beg;
+	qend = end;
+	for(int k = 0; k < sfns.size(); k++)
+	{
+		if(itrs[k] != NULL) hts_itr_destroy(itrs[k]);
+		itrs[k] = NULL;
+		int32_t t = (k == 0) ? tid : bam_name2id(hdrs[k], hdrs[0]->target_name[tid]);
+		if(t >= 0) itrs[k] = sam_itr_queryi(idxs[k], t, beg, end);
+		fetch(k);
+	}
+	return 0;
+}
+
+int32_t bam_merger::extend_left(int32_t tid, int32_t beg, int32_t lo)
+{
+	// move beg to the left while reads chain into it, so that the
+	// bundles reaching the region start where they would when the
+	// whole file is read; reads left of lo were read already
+	bam1_t *b = bam_init1();
+	while(beg > lo)
+	{
+		int32_t s = beg - gap - 1;
+		if(s < lo) s = lo;
+
+		int32_t m = beg;
+		for(int k = 0; k < sfns.size(); k++)
+		{
+			int32_t t = (k == 0) ? tid : bam_name2id(hdrs[k], hdrs[0]->target_name[tid]);
+			if(t < 0) continue;
+			hts_itr_t *itr = sam_itr_queryi(idxs[k], t, s, beg);
+			if(itr == NULL) continue;
+			while(sam_itr_next(sfns[k], itr, b) >= 0)
+			{
+				if(b->core.pos >= m) continue;
+				if(bam_endpos(b) + gap < beg) continue;
+				m = b->core.pos;
+			}
+			hts_itr_destroy(itr);
+		}
+
+		if(m >= beg) break;
+		beg = (m < lo) ? lo : m;
+	}
+	bam_destroy1(b);
+	return beg;
+}
+
+bool bam_merger::replayed() const
+{
+	return from_replay;
+}
+
+bam_hdr_t* bam_merger::header() const
+{
+	if(hdrs.size() == 0) return NULL;
+	return hdrs[0];
+}
+
+int bam_merger::project_fields(samFile *fn)
+{
+	// hits use core fields, CIGAR, qname and a few aux tags; for CRAM
+	// skipping sequence, qualities and MD/NM regeneration also means
+	// that no reference has to be fetched
+	if(fn->format.format != cram) return 0;
+	int f = SAM_QNAME | SAM_FLAG | SAM_RNAME | SAM_POS | SAM_MAPQ | SAM_CIGAR | SAM_RNEXT | SAM_PNEXT | SAM_TLEN | SAM_AUX;
+	hts_set_opt(fn, CRAM_OPT_REQUIRED_FIELDS, f);
+	hts_set_opt(fn, CRAM_OPT_DECODE_MD, 0);
+	return 0;
+}
+
+bam1_t* bam_merger::read(int &k)
+{
+	// the record returned last is still held by the caller
+	// until this call, so its file is refilled only now
+	if(last >= 0) fetch(last);
+	last = -1;
+
+	// move on to the next query once all files are exhausted
+	while(heap.size() == 0 && next_query() == 0);
+
+	k = -1;
+	if(heap.size() == 0) return NULL;
+
+	k = heap[0];
+	heap[0] = heap.back();
+	heap.pop_back();
+	if(heap.size() >= 1) sift_down(0);
+
+	last = k;
+	return bufs[k];
+}
+
+int bam_merger::fetch(int k)
+{
+	while(true)
+	{
+		if(k == 0) from_replay = false;
+		if(k == 0 && nreplay < replay.size())
+		{
+			bam_destroy1(bufs[0]);
+			bufs[0] = replay[nreplay++];
+			from_replay = true;
+		}
+		else if(itrs.size() == 0 && sam_read1(sfns[k], hdrs[k], bufs[k]) < 0) break;
+		else if(itrs.size() >= 1 && (itrs[k] == NULL || sam_itr_next(sfns[k], itrs[k], bufs[k]) < 0)) break;
+
+		bam1_t *b = bufs[k];
+		bam1_core_t &p = b->core;
+		if(p.tid >= 0) p.tid = tmaps[k][p.tid];
+		if(p.mtid >= 0) p.mtid = tmaps[k][p.mtid];
+
+		// reads overlapping the query but starting before it
+		if(itrs.size() >= 1)
+		{
+			if(p.pos < qbeg) continue;
+			int32_t e = bam_endpos(b);
+			if(e > qmax) qmax = e;
+		}
+
+		// mapped reads on unknown chromosomes cannot be placed
+		if(p.tid < 0 && (p.flag & 0x4) <= 0)
+		{
+			num_dropped++;
+			continue;
+		}
+
+		heap.push_back(k);
+		sift_up(heap.size() - 1);
+		return 0;
+	}
+	return -1;
+}
+
+bool bam_merger::less(int x, int y) const
+{
+	// unplaced reads (tid = -1) come last; ties keep file order
+	const bam1_core_t &a = bufs[x]->core;
+	const bam1_core_t &b = bufs[y]->core;
+	uint32_t ta = (uint32_t)(a.tid);
+	uint32_t tb = (uint32_t)(b.tid);
+	if(ta != tb) return ta < tb;
+	if(a.pos != b.pos) return a.pos < b.pos;
+	return x < y;
+}
+
+int bam_merger::sift_up(int i)
+{
+	while(i > 0)
+	{
+		int p = (i - 1) / 2;
+		if(less(heap[i], heap[p]) == false) break;
+		swap(heap[i], heap[p]);
+		i = p;
+	}
+	return 0;
+}
+
+int bam_merger::sift_down(int i)
+{
+	int n = heap.size();
+	while(true)
+	{
+		int l = 2 * i + 1;
+		int r = l + 1;
+		int m = i;
+		if(l < n && less(heap[l], heap[m])) m = l;
+		if(r < n && less(heap[r], heap[m])) m = r;
+		if(m == i) break;
+		swap(heap[i], heap[m]);
+		i = m;
+	}
+	return 0;
+}
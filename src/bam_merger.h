@@ -0,0 +1,76 @@
+/*
+Part of Scallop Transcript Assembler
+(c) 2017 by  Mingfu Shao, Carl Kingsford, and Carnegie Mellon University.
+See LICENSE for licensing.
+*/
+
+#ifndef __BAM_MERGER_H__
+#define __BAM_MERGER_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "htslib/sam.h"
+
+using namespace std;
+
+// reads several coordinate-sorted BAM/CRAM files as one stream,
+// ordered by (tid, pos) with a k-way heap merge; chromosome ids
+// of all files are translated into those of the first header;
+// with regions set, only reads of bundles reaching them are read
+class bam_merger
+{
+public:
+	bam_merger();
+	~bam_merger();
+
+private:
+	vector<samFile*> sfns;			// input files
+	vector<bam_hdr_t*> hdrs;		// headers of input files
+	vector<bam1_t*> bufs;			// next record of each file
+	vector< vector<int32_t> > tmaps;	// tid of each file -> tid in hdrs[0]
+	vector<int> heap;				// files with a buffered record
+	vector<bam1_t*> replay;			// records of the first file read before
+	int nreplay;					// number of records replayed so far
+	bool from_replay;				// whether the first file's record is replayed
+	int last;						// file of the record returned last
+	int64_t num_dropped;			// records on chromosomes missing in hdrs[0]
+
+	vector<hts_idx_t*> idxs;		// index of each file, for regions
+	vector<hts_itr_t*> itrs;		// iterator of each file over the query
+	vector<int32_t> rtids;			// merged regions, sorted
+	vector<int32_t> rbegs;
+	vector<int32_t> rends;
+	int nregion;					// next region to query
+	int gap;						// reads closer than this share a bundle
+	int32_t qtid;					// chromosome of the current query
+	int32_t qbeg;					// reads starting before qbeg were read already
+	int32_t qend;					// end of the current query
+	int32_t qmax;					// rightmost end of reads of the current region
+
+public:
+	int adopt(samFile *fn, bam_hdr_t *h, vector<bam1_t*> &v);
+	int open(const vector<string> &files);
+	int seek(int64_t offset);
+	int set_regions(const string &file, int min_gap);
+	bool replayed() const;
+	int size() const;
+	samFile* file(int k) const;
+	bam_hdr_t* header() const;
+	bam1_t* read(int &k);
+
+	static int project_fields(samFile *fn);
+
+private:
+	int fetch(int k);
+	int load_index();
+	int next_query();
+	int query(int32_t tid, int32_t beg, int32_t end);
+	int32_t extend_left(int32_t tid, int32_t beg, int32_t lo);
+	bool less(int x, int y) const;
+	int sift_up(int i);
+	int sift_down(int i);
+};
+
+#endif
@@ -0,0 +1,120 @@
+/*
+Part of Scallop Transcript Assembler
+(c) 2017 by  Mingfu Shao, Carl Kingsford, and Carnegie Mellon University.
+See LICENSE for licensing.
+*/
+
+#include <cfloat>
+#include <queue>
+#include <algorithm>
+
+#include "bottleneck_path.h"
+
+bottleneck_path::bottleneck_path(splice_graph &g)
+	: gr(g)
+{}
+
+int bottleneck_path::build()
+{
+	int n = gr.num_vertices();
+	order = gr.topological_sort();
+	assert(order.size() == n);
+
+	pos.assign(n, -1);
+	for(int i = 0; i < order.size(); i++) pos[order[i]] = i;
+
+	table.assign(n, -1);
+	back.assign(n, null_edge);
+	if(n == 0) return 0;
+
+	table[0] = DBL_MAX;
+	for(int i = 0; i < order.size(); i++)
+	{
+		if(order[i] == 0) continue;
+		compute(order[i]);
+	}
+	return 0;
+}
+
+bool bottleneck_path::compute(int x)
+{
+	double max_abd = -1;
+	edge_descriptor max_edge = null_edge;
+
+	if(gr.degree(x) >= 1)
+	{
+		double abd = 0;
+		edge_iterator it1, it2;
+		for(tie(it1, it2) = gr.in_edges(x); it1 != it2; it1++)
+		{
+			int s = (*it1)->source();
+			assert(pos[s] < pos[x]);
+			if(table[s] <= -1) continue;
+			double xw = gr.get_edge_weight(*it1);
+			double ww = xw < table[s] ? xw : table[s];
+			if(ww >= abd)
+			{
+				abd = ww;
+				max_edge = *it1;
+			}
+		}
+		if(max_edge != null_edge) max_abd = abd;
+	}
+
+	back[x] = max_edge;
+	if(table[x] == max_abd) return false;
+	table[x] = max_abd;
+	return true;
+}
+
+int bottleneck_path::update(const vector<int> &vv)
+{
+	// process dirty vertices in topological order; a vertex only
+	// affects its successors through its table value
+	priority_queue< int, vector<int>, greater<int> > q;
+	vector<bool> queued(order.size(), false);
+	for(int i = 0; i < vv.size(); i++)
+	{
+		int k = pos[vv[i]];
+		if(vv[i] == 0 || queued[k] == true) continue;
+		queued[k] = true;
+		q.push(k);
+	}
+
+	while(q.empty() == false)
+	{
+		int k = q.top();
+		q.pop();
+		int x = order[k];
+		if(compute(x) == false) continue;
+
+		edge_iterator it1, it2;
+		for(tie(it1, it2) = gr.out_edges(x); it1 != it2; it1++)
+		{
+			int t = pos[(*it1)->target()];
+			if(queued[t] == true) continue;
+			queued[t] = true;
+			q.push(t);
+		}
+	}
+	return 0;
+}
+
+double bottleneck_path::extract(VE &p) const
+{
+	p.clear();
+	int n = gr.num_vertices();
+	if(n == 0) return -1;
+
+	int x = n - 1;
+	while(true)
+	{
+		edge_descriptor e = back[x]; 
+		if(e == null_edge) break;
+		p.push_back(e);
+		x = e->source();
+	}
+	reverse(p.begin(), p.end());
+
+	return table[n - 1];
+}
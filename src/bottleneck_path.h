@@ -0,0 +1,42 @@
+/*
+Part of Scallop Transcript Assembler
+(c) 2017 by  Mingfu Shao, Carl Kingsford, and Carnegie Mellon University.
+See LICENSE for licensing.
+*/
+
+#ifndef __BOTTLENECK_PATH_H__
+#define __BOTTLENECK_PATH_H__
+
+#include <vector>
+
+#include "splice_graph.h"
+
+using namespace std;
+
+// maximum-bottleneck path from the source to the sink of a splice graph;
+// keeps the topological order and the DP tables between queries so that 
+// after a path is subtracted only the affected vertices are recomputed;
+// edges may be reweighted, removed or added as long as the topological 
+// order of the vertices remains valid
+class bottleneck_path
+{
+public:
+	bottleneck_path(splice_graph &gr);
+
+private:
+	splice_graph &gr;
+	vector<int> order;				// topological order of vertices
+	vector<int> pos;				// position of each vertex in order
+	vector<double> table;			// maximum bottleneck from source
+	VE back;						// backtrace edge pointers
+
+public:
+	int build();
+	int update(const vector<int> &vv);
+	double extract(VE &p) const;
+
+private:
+	bool compute(int x);
+};
+
+#endif
@@ -19,6 +19,13 @@ See LICENSE for licensing.
 bundle::bundle(const bundle_base &bb)
 	: bundle_base(bb)
 {
+	guard = NULL;
+}
+
+bundle::bundle(bundle_base &&bb)
+	: bundle_base(std::move(bb))
+{
+	guard = NULL;
 }
 
 bundle::~bundle()
@@ -26,38 +33,52 @@ bundle::~bundle()
 
 int bundle::build()
 {
+	restore();
+	if(aborted() == true) return -1;
+
 	compute_strand();
 
 	check_left_ascending();
 
 	build_junctions();
 	//correct_junctions();
+	if(aborted() == true) return -1;
 
 	build_regions();
 	build_partial_exons();
+	if(aborted() == true) return -1;
 
 	build_partial_exon_map();
 	link_partial_exons();
 	build_splice_graph();
+	if(aborted() == true) return -1;
 
 	revise_splice_graph();
+	if(aborted() == true) return -1;
 
 	build_hyper_edges2();
+	if(aborted() == true) return -1;
 
 	return 0;
 }
 
+bool bundle::aborted() const
+{
+	if(guard == NULL) return false;
+	return guard->expired();
+}
+
 int bundle::compute_strand()
 {
-	if(library_type != UNSTRANDED) assert(strand != '.');
-	if(library_type != UNSTRANDED) return 0;
+	if(cfg->library_type != UNSTRANDED) assert(strand != '.');
+	if(cfg->library_type != UNSTRANDED) return 0;
 
 	int n0 = 0, np = 0, nq = 0;
 	for(int i = 0; i < hits.size(); i++)
 	{
-		if(hits[i].xs == '.') n0++;
-		if(hits[i].xs == '+') np++;
-		if(hits[i].xs == '-') nq++;
+		if(hits[i].xs == '.') n0 += hits[i].weight;
+		if(hits[i].xs == '+') np += hits[i].weight;
+		if(hits[i].xs == '-') nq += hits[i].weight;
 	}
 
 	if(np > nq) strand = '+';
@@ -91,82 +112,51 @@ int bundle::check_right_ascending()
 
 int bundle::build_junctions()
 {
-	int min_max_boundary_quality = min_mapping_quality;
-	map< int64_t, vector<int> > m;
+	int min_max_boundary_quality = cfg->min_mapping_quality;
+
+	// collect (junction, hit) pairs and group them by junction
+	vector< pair<int64_t, int> > v;
 	for(int i = 0; i < hits.size(); i++)
 	{
-		vector<int64_t> v = hits[i].spos;
-		if(v.size() == 0) continue;
-
-		//hits[i].print();
-		for(int k = 0; k < v.size(); k++)
+		const int64_t *s = hits[i].spos;
+		for(int k = 0; k < hits[i].n_spos; k++)
 		{
-			int64_t p = v[k];
-
-			// DEBUG
-			/*
-			int32_t x1 = low32(p);
-			int32_t x2 = high32(p);
-			if(fabs(x1 - 9364768) <= 2 || fabs(x2 - 9364768) <=2)
-			{
-				printf("HIT ");
-				hits[i].print();
-			}
-			*/
-			if(m.find(p) == m.end())
-			{
-				vector<int> hv;
-				hv.push_back(i);
-				m.insert(pair< int64_t, vector<int> >(p, hv));
-			}
-			else
-			{
-				m[p].push_back(i);
-			}
+			v.push_back(pair<int64_t, int>(s[k], i));
 		}
 	}
+	radix_sort(v);
 
-	map< int64_t, vector<int> >::iterator it;
-	for(it = m.begin(); it != m.end(); it++)
+	int i = 0;
+	while(i < v.size())
 	{
-		vector<int> &v = it->second;
-		if(v.size() < min_splice_boundary_hits) continue;
-
-		int32_t p1 = high32(it->first);
-		int32_t p2 = low32(it->first);
+		int64_t p = v[i].first;
 
+		int c = 0;
 		int s0 = 0;
 		int s1 = 0;
 		int s2 = 0;
 		int nm = 0;
-		for(int k = 0; k < v.size(); k++)
+		for(; i < v.size() && v[i].first == p; i++)
 		{
-			hit &h = hits[v[k]];
-			nm += h.nm;
-			if(h.xs == '.') s0++;
-			if(h.xs == '+') s1++;
-			if(h.xs == '-') s2++;
+			hit &h = hits[v[i].second];
+			c += h.weight;
+			nm += h.nm * h.weight;
+			if(h.xs == '.') s0 += h.weight;
+			if(h.xs == '+') s1 += h.weight;
+			if(h.xs == '-') s2 += h.weight;
 		}
 
-		//printf("junction: %s:%d-%d (%d, %d, %d) %d\n", chrm.c_str(), p1, p2, s0, s1, s2, s1 < s2 ? s1 : s2);
+		if(c < cfg->min_splice_boundary_hits) continue;
+
+		//printf("junction: %s:%d-%d (%d, %d, %d) %d\n", chrm.c_str(), high32(p), low32(p), s0, s1, s2, s1 < s2 ? s1 : s2);
 
-		junction jc(it->first, v.size());
+		junction jc(p, c);
 		jc.nm = nm;
 		if(s1 == 0 && s2 == 0) jc.strand = '.';
 		else if(s1 >= 1 && s2 >= 1) jc.strand = '.';
 		else if(s1 > s2) jc.strand = '+';
 		else jc.strand = '-';
 		junctions.push_back(jc);
-
-		/*
-		uint32_t max_qual = 0;
-		for(int k = 0; k < v.size(); k++)
-		{
-			hit &h = hits[v[k]];
-			if(h.qual > max_qual) max_qual = h.qual;
-		}
-		assert(max_qual >= min_max_boundary_quality);
-		*/
 	}
 	return 0;
 }
@@ -201,7 +191,7 @@ int bundle::correct_junctions()
 			if(j1.rpos < j2.rpos) mmap += make_pair(ROI(j1.rpos, j2.rpos), 1);
 			else if(j1.rpos > j2.rpos) mmap += make_pair(ROI(j2.rpos, j1.rpos), -1);
 
-			if(verbose >= 2)
+			if(cfg->verbose >= 2)
 			{
 				j1.print(chrm, k - 1);
 				j2.print(chrm, k - 0);
@@ -217,7 +207,7 @@ int bundle::correct_junctions()
 			if(j2.rpos < j1.rpos) mmap += make_pair(ROI(j2.rpos, j1.rpos), 1);
 			else if(j2.rpos > j1.rpos) mmap += make_pair(ROI(j1.rpos, j2.rpos), -1);
 
-			if(verbose >= 2)
+			if(cfg->verbose >= 2)
 			{
 				j1.print(chrm, k - 1);
 				j2.print(chrm, k - 0);
@@ -237,6 +227,9 @@ int bundle::correct_junctions()
 
 int bundle::build_regions()
 {
+	cvg.clear();
+	if(cfg->use_dense_coverage == true) cvg.build(mmap, lpos, rpos);
+
 	MPI s;
 	s.insert(PI(lpos, START_BOUNDARY));
 	s.insert(PI(rpos, END_BOUNDARY));
@@ -244,9 +237,6 @@ int bundle::build_regions()
 	{
 		junction &jc = junctions[i];
 
-		double ave, dev;
-		evaluate_rectangle(mmap, jc.lpos, jc.rpos, ave, dev);
-
 		int32_t l = jc.lpos;
 		int32_t r = jc.rpos;
 
@@ -278,7 +268,7 @@ int bundle::build_regions()
 		if(ltype == LEFT_RIGHT_SPLICE) ltype = RIGHT_SPLICE;
 		if(rtype == LEFT_RIGHT_SPLICE) rtype = LEFT_SPLICE;
 
-		regions.push_back(region(l, r, ltype, rtype, &mmap, &imap));
+		regions.push_back(region(l, r, ltype, rtype, &mmap, &imap, cfg->use_dense_coverage ? &cvg : NULL, cfg));
 	}
 
 	return 0;
@@ -297,51 +287,99 @@ int bundle::build_partial_exons()
 
 int bundle::build_partial_exon_map()
 {
-	pmap.clear();
+	plpos.resize(pexons.size());
+	prpos.resize(pexons.size());
 	for(int i = 0; i < pexons.size(); i++)
 	{
-		partial_exon &p = pexons[i];
-		pmap += make_pair(ROI(p.lpos, p.rpos), i + 1);
+		plpos[i] = pexons[i].lpos;
+		prpos[i] = pexons[i].rpos;
+		assert(i == 0 || prpos[i - 1] <= plpos[i]);
 	}
 	return 0;
 }
 
-int bundle::locate_left_partial_exon(int32_t x)
+int bundle::search_partial_exon(int32_t x, int lo) const
+{
+	// branchless binary search in plpos[lo, n) for the last
+	// partial exon starting at or before x, -1 if x is not covered
+	int n = (int)(plpos.size()) - lo;
+	if(n <= 0 || plpos[lo] > x) return -1;
+
+	const int32_t *b = &plpos[lo];
+	while(n > 1)
+	{
+		int h = n / 2;
+		b = (b[h] <= x) ? b + h : b;
+		n -= h;
+	}
+
+	int k = b - &plpos[0];
+	if(x >= prpos[k]) return -1;
+	return k;
+}
+
+int bundle::locate_left_partial_exon(int32_t x) const
+{
+	return locate_left_partial_exon(x, search_partial_exon(x, 0));
+}
+
+int bundle::locate_left_partial_exon(int32_t x, int k) const
 {
-	SIMI it = pmap.find(ROI(x, x + 1));
-	if(it == pmap.end()) return -1;
-	assert(it->second >= 1);
-	assert(it->second <= pexons.size());
-
-	int k = it->second - 1;
-	int32_t p1 = lower(it->first);
-	int32_t p2 = upper(it->first);
+	if(k < 0) return -1;
+
+	int32_t p1 = plpos[k];
+	int32_t p2 = prpos[k];
 	assert(p2 >= x);
 	assert(p1 <= x);
 
-	if(x - p1 > min_flank_length && p2 - x < min_flank_length) k++;
+	if(x - p1 > cfg->min_flank_length && p2 - x < cfg->min_flank_length) k++;
 
 	if(k >= pexons.size()) return -1;
 	return k;
 }
 
-int bundle::locate_right_partial_exon(int32_t x)
+int bundle::locate_right_partial_exon(int32_t x) const
 {
-	SIMI it = pmap.find(ROI(x - 1, x));
-	if(it == pmap.end()) return -1;
-	assert(it->second >= 1);
-	assert(it->second <= pexons.size());
-
-	int k = it->second - 1;
-	int32_t p1 = lower(it->first);
-	int32_t p2 = upper(it->first);
+	return locate_right_partial_exon(x, search_partial_exon(x - 1, 0));
+}
+
+int bundle::locate_right_partial_exon(int32_t x, int k) const
+{
+	if(k < 0) return -1;
+
+	int32_t p1 = plpos[k];
+	int32_t p2 = prpos[k];
 	assert(p1 < x);
 	assert(p2 >= x);
 
-	if(p2 - x > min_flank_length && x - p1 <= min_flank_length) k--;
+	if(p2 - x > cfg->min_flank_length && x - p1 <= cfg->min_flank_length) k--;
 	return k;
 }
 
+int bundle::locate_partial_exons(const int64_t *v, int n, vector<int> &sp) const
+{
+	// matched intervals of a hit are ascending, so each
+	// search only needs to look right of the previous one
+	int lo = 0;
+	for(int k = 0; k < n; k++)
+	{
+		int32_t p1 = high32(v[k]);
+		int32_t p2 = low32(v[k]);
+
+		int x1 = search_partial_exon(p1, lo);
+		int x2 = search_partial_exon(p2 - 1, (x1 >= 0) ? x1 : lo);
+		if(x1 >= 0) lo = x1;
+		if(x2 >= 0) lo = x2;
+
+		int k1 = locate_left_partial_exon(p1, x1);
+		int k2 = locate_right_partial_exon(p2, x2);
+		if(k1 < 0 || k2 < 0) continue;
+
+		for(int j = k1; j <= k2; j++) sp.push_back(j);
+	}
+	return 0;
+}
+
 int bundle::build_hyper_edges1()
 {
 	hs.clear();
@@ -350,25 +388,14 @@ int bundle::build_hyper_edges1()
 		hit &h = hits[i];
 		if((h.flag & 0x4) >= 1) continue;
 
-		vector<int64_t> v;
-		h.get_matched_intervals(v);
-		if(v.size() == 0) continue;
-
-		set<int> sp;
-		for(int k = 0; k < v.size(); k++)
-		{
-			int32_t p1 = high32(v[k]);
-			int32_t p2 = low32(v[k]);
+		if(h.n_matched == 0) continue;
 
-			int k1 = locate_left_partial_exon(p1);
-			int k2 = locate_right_partial_exon(p2);
-			if(k1 < 0 || k2 < 0) continue;
-
-			for(int j = k1; j <= k2; j++) sp.insert(j);
-		}
+		vector<int> sv;
+		locate_partial_exons(h.itvs, h.n_matched, sv);
+		set<int> sp(sv.begin(), sv.end());
 
 		if(sp.size() <= 1) continue;
-		hs.add_node_list(sp);
+		hs.add_node_list(sp, h.weight);
 	}
 
 	return 0;
@@ -387,8 +414,14 @@ int bundle::build_hyper_edges2()
 
 	hs.clear();
 
+	bmap.clear();
+	bpaths.clear();
+
+	// collapsed hits of a pair are phased with the smaller weight
+	vector<int> sp3;
 	string qname;
 	int hi = -2;
+	int w = 0;
 	vector<int> sp1;
 	for(int i = 0; i < hits.size(); i++)
 	{
@@ -404,30 +437,19 @@ int bundle::build_hyper_edges2()
 		if(h.qname != qname || h.hi != hi)
 		{
 			set<int> s(sp1.begin(), sp1.end());
-			if(s.size() >= 2) hs.add_node_list(s);
+			if(s.size() >= 2) hs.add_node_list(s, w);
 			sp1.clear();
+			w = h.weight;
 		}
 
 		qname = h.qname;
 		hi = h.hi;
+		if(h.weight < w) w = h.weight;
 
 		if((h.flag & 0x4) >= 1) continue;
 
-		vector<int64_t> v;
-		h.get_matched_intervals(v);
-
 		vector<int> sp2;
-		for(int k = 0; k < v.size(); k++)
-		{
-			int32_t p1 = high32(v[k]);
-			int32_t p2 = low32(v[k]);
-
-			int k1 = locate_left_partial_exon(p1);
-			int k2 = locate_right_partial_exon(p2);
-			if(k1 < 0 || k2 < 0) continue;
-
-			for(int j = k1; j <= k2; j++) sp2.push_back(j);
-		}
+		locate_partial_exons(h.itvs, h.n_matched, sp2);
 
 		if(sp1.size() <= 0 || sp2.size() <= 0)
 		{
@@ -453,7 +475,6 @@ int bundle::build_hyper_edges2()
 			x2 = sp1[min_element(sp1)];
 		}
 
-		vector<int> sp3;
 		bool c = bridge_read(x1, x2, sp3);
 
 		//printf("=========\n");
@@ -461,7 +482,7 @@ int bundle::build_hyper_edges2()
 		if(c == false)
 		{
 			set<int> s(sp1.begin(), sp1.end());
-			if(s.size() >= 2) hs.add_node_list(s);
+			if(s.size() >= 2) hs.add_node_list(s, w);
 			sp1 = sp2;
 		}
 		else
@@ -475,6 +496,34 @@ int bundle::build_hyper_edges2()
 }
 
 bool bundle::bridge_read(int x, int y, vector<int> &v)
+{
+	// the graph is fixed while phasing, so the result of
+	// each pair of partial exons is computed only once
+	v.clear();
+	if(x >= y) return true;
+
+	int64_t p = pack(x, y);
+	map<int64_t, int>::iterator it = bmap.find(p);
+	if(it != bmap.end())
+	{
+		if(it->second < 0) return false;
+		v = bpaths[it->second];
+		return true;
+	}
+
+	bool b = compute_bridge(x, y, v);
+	if(b == false)
+	{
+		bmap.insert(pair<int64_t, int>(p, -1));
+		return false;
+	}
+
+	bmap.insert(pair<int64_t, int>(p, bpaths.size()));
+	bpaths.push_back(v);
+	return true;
+}
+
+bool bundle::compute_bridge(int x, int y, vector<int> &v)
 {
 	v.clear();
 	if(x >= y) return true;
@@ -686,6 +735,8 @@ int bundle::revise_splice_graph()
 {
 	while(true)
 	{
+		if(aborted() == true) return 0;
+
 		bool b = false;
 
 		b = extend_boundaries();
@@ -838,7 +889,7 @@ bool bundle::keep_surviving_edges()
 		double w = gr.get_edge_weight(*it1);
 		int32_t p1 = gr.get_vertex_info(s).rpos;
 		int32_t p2 = gr.get_vertex_info(t).lpos;
-		if(w < min_surviving_edge_weight) continue;
+		if(w < cfg->min_surviving_edge_weight) continue;
 		se.insert(*it1);
 		sv1.insert(t);
 		sv2.insert(s);
@@ -895,7 +946,7 @@ bool bundle::keep_surviving_edges()
 
 	for(int i = 0; i < ve.size(); i++)
 	{
-		if(verbose >= 2) printf("remove edge (%d, %d), weight = %.2lf\n", ve[i]->source(), ve[i]->target(), gr.get_edge_weight(ve[i]));
+		if(cfg->verbose >= 2) printf("remove edge (%d, %d), weight = %.2lf\n", ve[i]->source(), ve[i]->target(), gr.get_edge_weight(ve[i]));
 		gr.remove_edge(ve[i]);
 	}
 
@@ -913,7 +964,7 @@ bool bundle::remove_small_exons()
 		int32_t p1 = gr.get_vertex_info(i).lpos;
 		int32_t p2 = gr.get_vertex_info(i).rpos;
 
-		if(p2 - p1 >= min_exon_length) continue;
+		if(p2 - p1 >= cfg->min_exon_length) continue;
 		if(gr.degree(i) <= 0) continue;
 
 		for(tie(it1, it2) = gr.in_edges(i); it1 != it2; it1++)
@@ -1048,7 +1099,7 @@ bool bundle::remove_inner_boundaries()
 
 		if(vi.stddev >= 0.01) continue;
 
-		if(verbose >= 2) printf("remove inner boundary: vertex = %d, weight = %.2lf, length = %d, pos = %d-%d\n",
+		if(cfg->verbose >= 2) printf("remove inner boundary: vertex = %d, weight = %.2lf, length = %d, pos = %d-%d\n",
 				i, gr.get_vertex_weight(i), vi.length, vi.lpos, vi.rpos);
 
 		gr.clear_vertex(i);
@@ -1087,9 +1138,9 @@ bool bundle::remove_intron_contamination()
 		double we = gr.get_edge_weight(ee);
 
 		if(wv > we) continue;
-		if(wv > max_intron_contamination_coverage) continue;
+		if(wv > cfg->max_intron_contamination_coverage) continue;
 
-		if(verbose >= 2) printf("clear intron contamination %d, weight = %.2lf, length = %d, edge weight = %.2lf\n", i, wv, vi.length, we);
+		if(cfg->verbose >= 2) printf("clear intron contamination %d, weight = %.2lf, length = %d, edge weight = %.2lf\n", i, wv, vi.length, we);
 
 		gr.clear_vertex(i);
 		flag = true;
@@ -1116,15 +1167,21 @@ int bundle::print(int index)
 	int n0 = 0, np = 0, nq = 0;
 	for(int i = 0; i < hits.size(); i++)
 	{
-		if(hits[i].xs == '.') n0++;
-		if(hits[i].xs == '+') np++;
-		if(hits[i].xs == '-') nq++;
+		if(hits[i].xs == '.') n0 += hits[i].weight;
+		if(hits[i].xs == '+') np += hits[i].weight;
+		if(hits[i].xs == '-') nq += hits[i].weight;
 	}
 
-	printf("tid = %d, #hits = %lu, #partial-exons = %lu, range = %s:%d-%d, orient = %c (%d, %d, %d), num-long-reads = %d\n",
-			tid, hits.size(), pexons.size(), chrm.c_str(), lpos, rpos, strand, n0, np, nq, num_long_reads);
+	printf("tid = %d, #hits = %d, #distinct-hits = %lu, #partial-exons = %lu, range = %s:%d-%d, orient = %c (%d, %d, %d), num-long-reads = %d\n",
+			tid, num_reads, hits.size(), pexons.size(), chrm.c_str(), lpos, rpos, strand, n0, np, nq, num_long_reads);
+
+	if(num_thinned_hits >= 1)
+	{
+		printf("Bundle %d: downsampled, %d hits dropped, %lu hits kept (%.3lf of stored hits)\n",
+				index, num_thinned_hits, hits.size(), hits.size() * 1.0 / (hits.size() + num_thinned_hits));
+	}
 
-	if(verbose <= 1) return 0;
+	if(cfg->verbose <= 1) return 0;
 
 	// print hits
 	for(int i = 0; i < hits.size(); i++) hits[i].print();
@@ -1183,7 +1240,7 @@ int bundle::output_transcript(ofstream &fout, const path &p, const string &gid,
 	int32_t rr = pexons[tt - 1].rpos;
 
 	fout<<chrm.c_str()<<"\t";		// chromosome name
-	fout<<algo.c_str()<<"\t";		// source
+	fout<<cfg->algo.c_str()<<"\t";		// source
 	fout<<"transcript\t";			// feature
 	fout<<ll + 1<<"\t";				// left position
 	fout<<rr<<"\t";					// right position
@@ -1205,7 +1262,7 @@ int bundle::output_transcript(ofstream &fout, const path &p, const string &gid,
 	for(JIMI it = jmap.begin(); it != jmap.end(); it++)
 	{
 		fout<<chrm.c_str()<<"\t";			// chromosome name
-		fout<<algo.c_str()<<"\t";			// source
+		fout<<cfg->algo.c_str()<<"\t";			// source
 		fout<<"exon\t";						// feature
 		fout<<lower(it->first) + 1<<"\t";	// left position
 		fout<<upper(it->first)<<"\t";		// right position
@@ -1248,7 +1305,7 @@ int bundle::output_transcripts(gene &gn, const vector<path> &p, const string &gi
 int bundle::output_transcript(transcript &trst, const path &p, const string &gid, const string &tid) const
 {
 	trst.seqname = chrm;
-	trst.source = algo;
+	trst.source = cfg->algo;
 	trst.gene_id = gid;
 	trst.transcript_id = tid;
 	trst.coverage = p.abd;
@@ -17,6 +17,7 @@ See LICENSE for licensing.
 #include "path.h"
 #include "gene.h"
 #include "transcript.h"
+#include "watchdog.h"
 
 using namespace std;
 
@@ -24,18 +25,25 @@ class bundle : public bundle_base
 {
 public:
 	bundle(const bundle_base &bb);
+	bundle(bundle_base &&bb);
 	virtual ~bundle();
 
 public:
 	vector<junction> junctions;		// splice junctions
 	vector<region> regions;			// regions
 	vector<partial_exon> pexons;	// partial exons
-	split_interval_map pmap;		// partial exon map
+	vector<int32_t> plpos;			// left boundaries of partial exons
+	vector<int32_t> prpos;			// right boundaries of partial exons
+	coverage cvg;					// dense coverage, built if use_dense_coverage
 	splice_graph gr;				// splice graph
 	hyper_set hs;					// hyper edges
+	const watchdog *guard;			// polled between stages, may be NULL
+	map<int64_t, int> bmap;			// bridged pair pack(x, y) -> index in bpaths, -1 if not bridged
+	vector< vector<int> > bpaths;	// unique intermediate partial exons of bridged pairs
 
 public:
-	virtual int build();
+	virtual int build();			// return -1 if aborted by guard
+	bool aborted() const;
 	int output_transcripts(ofstream &fout, const vector<path> &p, const string &gid) const;	
 	int output_transcripts(gene &gn, const vector<path> &p, const string &gid) const;	
 	int output_transcripts(vector<transcript> &trsts, const vector<path> &p, const string &gid) const;	
@@ -58,8 +66,12 @@ private:
 	int link_partial_exons();
 	int build_splice_graph();
 	int build_partial_exon_map();
-	int locate_left_partial_exon(int32_t x);
-	int locate_right_partial_exon(int32_t x);
+	int search_partial_exon(int32_t x, int lo) const;
+	int locate_left_partial_exon(int32_t x) const;
+	int locate_left_partial_exon(int32_t x, int k) const;
+	int locate_right_partial_exon(int32_t x) const;
+	int locate_right_partial_exon(int32_t x, int k) const;
+	int locate_partial_exons(const int64_t *v, int n, vector<int> &sp) const;
 
 	// revise splice graph
 	VE compute_maximal_edges();
@@ -76,6 +88,7 @@ private:
 	int build_hyper_edges1();			// single end
 	int build_hyper_edges2();			// paired end
 	bool bridge_read(int x, int y, vector<int> &s);
+	bool compute_bridge(int x, int y, vector<int> &s);
 
 };
 
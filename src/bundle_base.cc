@@ -7,17 +7,32 @@ See LICENSE for licensing.
 #include <cassert>
 #include <cstdio>
 #include <cmath>
+#include <cstdlib>
+#include <fstream>
 
 #include "bundle_base.h"
+#include "config.h"
 
-bundle_base::bundle_base()
+bundle_base::bundle_base(const parameters *_cfg)
 {
+	cfg = _cfg;
 	tid = -1;
 	chrm = "";
 	lpos = INT32_MAX;
 	rpos = 0;
 	strand = '.';
 	num_long_reads = 0;
+	num_reads = 0;
+	dpos = -1;
+	num_thinned_hits = 0;
+	num_live_hits = 0;
+	num_dropped_hits = 0;
+	num_offered = 0;
+	capacity = cfg->max_hits_in_bundle;
+	seed = 88172645463325252ull;
+	hit_bytes = 0;
+	spill_file = "";
+	num_spilled_hits = 0;
 }
 
 bundle_base::~bundle_base()
@@ -25,10 +40,28 @@ bundle_base::~bundle_base()
 
 int bundle_base::add_hit(const hit &ht)
 {
-	if(ht.is_long_read == true) num_long_reads++;
+	if(ht.is_long_read == true) num_long_reads += ht.weight;
+	num_reads += ht.weight;
+
+	// reads are always kept while one of their junctions is rare
+	bool rare = false;
+	for(int k = 0; cfg->max_hits_in_bundle > 0 && k < ht.n_spos; k++)
+	{
+		int &c = jcount[ht.spos[k]];
+		if(c < cfg->max_rare_junction_hits) rare = true;
+		c += ht.weight;
+	}
+
+	// identical alignment already stored
+	if(cfg->collapse_identical_hits == true && rare == false && collapse_hit(ht) >= 0)
+	{
+		add_intervals(ht);
+		return 0;
+	}
 
 	// store new hit
 	hits.push_back(ht);
+	hit_bytes += ht.memory_usage();
 
 	// calcuate the boundaries on reference
 	if(ht.pos < lpos) lpos = ht.pos;
@@ -50,35 +83,319 @@ int bundle_base::add_hit(const hit &ht)
 	}
 	*/
 
-	// add intervals
-	vector<int64_t> vm;
-	vector<int64_t> vi;
-	vector<int64_t> vd;
-	ht.get_mid_intervals(vm, vi, vd);
+	add_intervals(ht);
+
+	if(cfg->max_hits_in_bundle > 0) sample_hit(hits.size() - 1, rare);
+	return 0;
+}
+
+int bundle_base::sample_hit(int i, bool rare)
+{
+	// fragments, i.e., a single hit or the two mates of a pair, are
+	// sampled as they arrive, keeping a uniform sample (algorithm R);
+	// a second mate follows the fate of the first one
+	num_live_hits++;
+	hstat.push_back(rare ? 'k' : 's');
+	assert(hstat.size() == hits.size());
+
+	const hit &h = hits[i];
+	bool paired = ((h.flag & 0x1) >= 1 && (h.flag & 0x8) <= 0);
+	string key = paired ? h.qname + "\t" + tostring(h.hi) : "";
+
+	map<string, int>::iterator it = paired ? pending.find(key) : pending.end();
+	if(it != pending.end())
+	{
+		int j = it->second;
+		pending.erase(it);
+		if(j >= 0) slots[j].second = i;
+		else if(j == -2) hstat[i] = 'k';
+		else if(rare == false) drop_hit(i);
+	}
+	else if(rare == true)
+	{
+		if(paired == true) pending.insert(pair<string, int>(key, -2));
+	}
+	else
+	{
+		int j = offer_fragment(i);
+		if(paired == true) pending.insert(pair<string, int>(key, j));
+	}
+
+	// shrink the sample until the stored hits fit; a random subset
+	// of a uniform sample is uniform, so algorithm R goes on
+	while(num_live_hits > cfg->max_hits_in_bundle && slots.size() >= 1)
+	{
+		int j = random(slots.size());
+		evict_fragment(j);
+		int n = slots.size() - 1;
+		if(j != n)
+		{
+			slots[j] = slots[n];
+			const hit &x = hits[slots[j].first];
+			if(slots[j].second == -1 && (x.flag & 0x1) >= 1)
+			{
+				it = pending.find(x.qname + "\t" + tostring(x.hi));
+				if(it != pending.end() && it->second == n) it->second = j;
+			}
+		}
+		slots.pop_back();
+		capacity = slots.size();
+	}
+
+	if(num_dropped_hits * 4 > num_live_hits) compact_hits();
+	return 0;
+}
 
-	//ht.print();
-	for(int k = 0; k < vm.size(); k++)
+int bundle_base::offer_fragment(int i)
+{
+	num_offered++;
+	if(slots.size() < capacity)
 	{
-		int32_t s = high32(vm[k]);
-		int32_t t = low32(vm[k]);
+		slots.push_back(PI(i, -1));
+		return slots.size() - 1;
+	}
+
+	int j = random(num_offered);
+	if(j >= slots.size())
+	{
+		drop_hit(i);
+		return -1;
+	}
+
+	evict_fragment(j);
+	slots[j] = PI(i, -1);
+	return j;
+}
+
+int bundle_base::evict_fragment(int j)
+{
+	int x = slots[j].first;
+	int y = slots[j].second;
+
+	// the mate still to come is dropped as well
+	const hit &h = hits[x];
+	if(y == -1 && (h.flag & 0x1) >= 1)
+	{
+		map<string, int>::iterator it = pending.find(h.qname + "\t" + tostring(h.hi));
+		if(it != pending.end() && it->second == j) it->second = -1;
+	}
+
+	if(hstat[x] == 's') drop_hit(x);
+	if(y >= 0 && hstat[y] == 's') drop_hit(y);
+	return 0;
+}
+
+int bundle_base::drop_hit(int i)
+{
+	assert(hstat[i] != 'x');
+	hstat[i] = 'x';
+	num_live_hits--;
+	num_dropped_hits++;
+	num_thinned_hits++;
+	hit_bytes -= hits[i].memory_usage();
+
+	// the hit may be indexed for collapsing
+	dpos = -1;
+	dmap.clear();
+	return 0;
+}
+
+int bundle_base::compact_hits()
+{
+	// dropped hits are removed in place, keeping the order of the others
+	vector<int> m(hits.size(), -1);
+	int k = 0;
+	for(int i = 0; i < hits.size(); i++)
+	{
+		if(hstat[i] == 'x') continue;
+		if(k != i) hits[k] = std::move(hits[i]);
+		hstat[k] = hstat[i];
+		m[i] = k++;
+	}
+	hits.erase(hits.begin() + k, hits.end());
+	hstat.resize(k);
+
+	for(int j = 0; j < slots.size(); j++)
+	{
+		slots[j].first = m[slots[j].first];
+		if(slots[j].second >= 0) slots[j].second = m[slots[j].second];
+	}
+
+	num_dropped_hits = 0;
+	dpos = -1;
+	dmap.clear();
+	return 0;
+}
+
+int bundle_base::downsample()
+{
+	if(hstat.size() == 0) return 0;
+
+	compact_hits();
+
+	// each of the n sampled fragments stands for num_offered / n of
+	// those offered; multiplying their weights by that ratio, rounded
+	// so that it sums to num_offered, keeps junction counts and the
+	// phasing of mates unbiased; coverage was taken from all reads
+	int n = slots.size();
+	for(int j = 0; j < n && num_offered > n; j++)
+	{
+		int64_t a = ((int64_t)(j) * num_offered * 2 + n) / (2 * n);
+		int64_t b = ((int64_t)(j + 1) * num_offered * 2 + n) / (2 * n);
+		int x = slots[j].first;
+		int y = slots[j].second;
+		if(hstat[x] == 's') hits[x].weight *= (b - a);
+		if(y >= 0 && hstat[y] == 's') hits[y].weight *= (b - a);
+	}
+
+	vector<char>().swap(hstat);
+	vector<PI>().swap(slots);
+	pending.clear();
+	jcount.clear();
+	num_live_hits = 0;
+	num_offered = 0;
+	capacity = cfg->max_hits_in_bundle;
+	return 0;
+}
+
+int64_t bundle_base::random(int64_t n)
+{
+	// xorshift64*, seeded per bundle so runs are reproducible
+	seed ^= seed >> 12;
+	seed ^= seed << 25;
+	seed ^= seed >> 27;
+	return (int64_t)((seed * 2685821657736338717ull) % (uint64_t)(n));
+}
+
+int bundle_base::collapse_hit(const hit &ht)
+{
+	// mates are phased by qname in bundle::build_hyper_edges2, and
+	// a collapsed mate would lose its own; so only hits of reads
+	// without a mate are collapsed
+	if((ht.flag & 0x1) >= 1) return -1;
+
+	// hits arrive sorted by pos, so only those starting
+	// at the same position could be identical to ht
+	if(ht.pos != dpos)
+	{
+		dpos = ht.pos;
+		dmap.clear();
+	}
+
+	// different alignments may share a key, all are kept
+	int64_t key = ht.alignment_key();
+	pair<multimap<int64_t, int>::iterator, multimap<int64_t, int>::iterator> r = dmap.equal_range(key);
+	for(multimap<int64_t, int>::iterator it = r.first; it != r.second; it++)
+	{
+		hit &h = hits[it->second];
+		if(h.same_alignment(ht) == false) continue;
+		h.weight += ht.weight;
+		return it->second;
+	}
+
+	dmap.insert(pair<int64_t, int>(key, hits.size()));
+	return -1;
+}
+
+int bundle_base::add_intervals(const hit &ht)
+{
+	int w = ht.weight;
+	for(int k = 0; k < ht.n_matched; k++)
+	{
+		int32_t s = high32(ht.itvs[k]);
+		int32_t t = low32(ht.itvs[k]);
 		//printf(" add interval %d-%d\n", s, t);
-		mmap += make_pair(ROI(s, t), 1);
+		mmap += make_pair(ROI(s, t), w);
+	}
+
+	// inserted and deleted intervals follow the matched ones
+	int n = ht.n_matched + ht.n_inserted + ht.n_deleted;
+	for(int k = ht.n_matched; k < n; k++)
+	{
+		int32_t s = high32(ht.itvs[k]);
+		int32_t t = low32(ht.itvs[k]);
+		imap += make_pair(ROI(s, t), w);
 	}
 
-	for(int k = 0; k < vi.size(); k++)
+	return 0;
+}
+
+int64_t bundle_base::memory_usage() const
+{
+	// each node of an interval map takes roughly 64 bytes
+	return hit_bytes + 64 * (mmap.iterative_size() + imap.iterative_size());
+}
+
+int bundle_base::spill()
+{
+	assert(spill_file != "");
+	if(hits.size() == 0) return 0;
+
+	ofstream fout(spill_file.c_str(), ios::binary | ios::app);
+	if(fout.fail())
 	{
-		int32_t s = high32(vi[k]);
-		int32_t t = low32(vi[k]);
-		imap += make_pair(ROI(s, t), 1);
+		printf("error: cannot write spill file %s\n", spill_file.c_str());
+		exit(-1);
 	}
 
-	for(int k = 0; k < vd.size(); k++)
+	for(int i = 0; i < hits.size(); i++) hits[i].write(fout);
+	fout.close();
+
+	if(fout.fail())
 	{
-		int32_t s = high32(vd[k]);
-		int32_t t = low32(vd[k]);
-		imap += make_pair(ROI(s, t), 1);
+		printf("error: failed to write spill file %s\n", spill_file.c_str());
+		remove(spill_file.c_str());
+		exit(-1);
 	}
 
+	num_spilled_hits += hits.size();
+	vector<hit>().swap(hits);
+	hit_bytes = 0;
+	dpos = -1;
+	dmap.clear();
+	return 0;
+}
+
+int bundle_base::restore()
+{
+	if(spill_file == "") return 0;
+
+	ifstream fin(spill_file.c_str(), ios::binary);
+	if(fin.fail())
+	{
+		printf("error: cannot read spill file %s\n", spill_file.c_str());
+		exit(-1);
+	}
+
+	// spilled hits precede those still in memory; the whole bundle
+	// is held again while it is built, as mates are phased over all hits
+	vector<hit> v;
+	v.reserve(num_spilled_hits + hits.size());
+	for(int i = 0; i < num_spilled_hits; i++)
+	{
+		v.push_back(hit(fin, *cfg));
+		if(fin.fail() == false) continue;
+		printf("error: spill file %s is truncated\n", spill_file.c_str());
+		exit(-1);
+	}
+	fin.close();
+
+	v.insert(v.end(), hits.begin(), hits.end());
+	hits.swap(v);
+
+	hit_bytes = 0;
+	for(int i = 0; i < hits.size(); i++) hit_bytes += hits[i].memory_usage();
+
+	remove_spill();
+	return 0;
+}
+
+int bundle_base::remove_spill()
+{
+	if(spill_file == "") return 0;
+	remove(spill_file.c_str());
+	spill_file = "";
+	num_spilled_hits = 0;
 	return 0;
 }
 
@@ -100,6 +417,22 @@ int bundle_base::clear()
 	mmap.clear();
 	imap.clear();
 	num_long_reads = 0;
+	num_reads = 0;
+	dpos = -1;
+	dmap.clear();
+	num_thinned_hits = 0;
+	num_live_hits = 0;
+	num_dropped_hits = 0;
+	num_offered = 0;
+	capacity = cfg->max_hits_in_bundle;
+	seed = 88172645463325252ull;
+	hstat.clear();
+	slots.clear();
+	pending.clear();
+	jcount.clear();
+	hit_bytes = 0;
+	spill_file = "";
+	num_spilled_hits = 0;
 	return 0;
 }
 
@@ -11,6 +11,7 @@ See LICENSE for licensing.
 #include <cstring>
 #include <string>
 #include <vector>
+#include <map>
 
 #include "hit.h"
 #include "interval_map.h"
@@ -20,10 +21,15 @@ using namespace std;
 class bundle_base
 {
 public:
-	bundle_base();
+	bundle_base(const parameters *_cfg);
+	bundle_base(const bundle_base &bb) = default;
+	bundle_base(bundle_base &&bb) = default;
+	bundle_base& operator=(const bundle_base &bb) = default;
+	bundle_base& operator=(bundle_base &&bb) = default;
 	virtual ~bundle_base();
 
 public:
+	const parameters *cfg;			// parameters of the assembly
 	int32_t tid;					// chromosome ID
 	string chrm;					// chromosome name
 	int32_t lpos;					// the leftmost boundary on reference
@@ -34,9 +40,41 @@ public:
 	split_interval_map imap;		// indel interval map
 
 	int num_long_reads;				// number of long reads in this bundle
+	int num_reads;					// number of reads, counting collapsed hits
+
+	int32_t dpos;					// position of the hits indexed in dmap
+	multimap<int64_t, int> dmap;	// alignment key -> indices of hits starting at dpos
+
+	int num_thinned_hits;			// number of hits dropped by downsampling
+	int num_live_hits;				// number of stored hits not dropped
+	int num_dropped_hits;			// number of dropped hits still stored
+	int num_offered;				// number of fragments offered to the sampler
+	int capacity;					// maximum number of sampled fragments
+	vector<char> hstat;				// per hit: 'k' always kept, 's' sampled, 'x' dropped
+	vector< PI > slots;				// hits of sampled fragments, -1 for a missing mate
+	map<string, int> pending;		// qname and hi of a first mate -> its slot, -1 dropped, -2 kept
+	map<int64_t, int> jcount;		// junction -> number of reads seen
+	uint64_t seed;					// state of the random generator
+
+	int64_t hit_bytes;				// estimated bytes held by hits
+	string spill_file;				// file holding spilled hits
+	int num_spilled_hits;			// number of hits in spill_file
 
 public:
 	int add_hit(const hit &ht);
+	int add_intervals(const hit &ht);
+	int collapse_hit(const hit &ht);
+	int sample_hit(int i, bool rare);
+	int offer_fragment(int i);
+	int evict_fragment(int j);
+	int drop_hit(int i);
+	int compact_hits();
+	int downsample();
+	int64_t random(int64_t n);
+	int64_t memory_usage() const;
+	int spill();
+	int restore();
+	int remove_spill();
 	bool overlap(const hit &ht) const;
 	int clear();
 };
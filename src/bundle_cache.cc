@@ -0,0 +1,381 @@
+/*
+Part of Scallop Transcript Assembler
+(c) 2017 by  Mingfu Shao, Carl Kingsford, and Carnegie Mellon University.
+See LICENSE for licensing.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <sys/stat.h>
+
+#include "bundle_cache.h"
+#include "config.h"
+
+bundle_cache::bundle_cache(const parameters *_cfg)
+{
+	cfg = _cfg;
+	file = cfg->bundle_cache_file;
+	graphs = false;
+	num_bundles = 0;
+	num_graphs = 0;
+	qlen = 0;
+	qcnt = 0;
+}
+
+bundle_cache::~bundle_cache()
+{
+	discard();
+}
+
+string bundle_cache::make_key() const
+{
+	// an input, or the regions file, is identified by its path, size
+	// and time of modification; options are those used before bundle::build
+	vector<string> files = cfg->input_files;
+	if(cfg->regions_file != "") files.push_back(cfg->regions_file);
+
+	stringstream sstr;
+	for(int i = 0; i < files.size(); i++)
+	{
+		struct stat st;
+		if(stat(files[i].c_str(), &st) != 0) return "";
+		sstr << files[i] << " " << st.st_size << " " << st.st_mtime << " ";
+	}
+
+	sstr << cfg->library_type << " ";
+	sstr << cfg->min_flank_length << " ";
+	sstr << cfg->min_bundle_gap << " ";
+	sstr << cfg->min_num_hits_in_bundle << " ";
+	sstr << cfg->min_mapping_quality << " ";
+	sstr << cfg->uniquely_mapped_only << " ";
+	sstr << cfg->use_second_alignment << " ";
+	sstr << cfg->collapse_identical_hits << " ";
+	sstr << cfg->max_hits_in_bundle << " ";
+	sstr << cfg->max_rare_junction_hits;
+	return sstr.str();
+}
+
+string bundle_cache::make_bundle_key() const
+{
+	// options used by bundle::build, see parameters::same_bundle
+	stringstream sstr;
+	sstr.precision(17);
+	sstr << cfg->min_splice_boundary_hits << " ";
+	sstr << cfg->min_subregion_gap << " ";
+	sstr << cfg->min_subregion_overlap << " ";
+	sstr << cfg->min_subregion_length << " ";
+	sstr << cfg->use_dense_coverage << " ";
+	sstr << cfg->max_intron_contamination_coverage << " ";
+	sstr << cfg->min_surviving_edge_weight << " ";
+	sstr << cfg->min_exon_length;
+	return sstr.str();
+}
+
+bool bundle_cache::open_read()
+{
+	key = make_key();
+	if(key == "") return false;
+
+	fin.open(file.c_str(), ios::binary);
+	if(fin.fail()) return false;
+
+	string s, k, b;
+	getline(fin, s);
+	getline(fin, k);
+	getline(fin, b);
+	if(s != "scallop-bundle-cache 2" || k != key)
+	{
+		printf("bundle cache %s does not match the input or options, rebuild it\n", file.c_str());
+		fin.close();
+		return false;
+	}
+
+	// graphs of a sweep are built with the options of each setting
+	bkey = make_bundle_key();
+	graphs = (b == bkey && cfg->sweep_file == "");
+	if(cfg->verbose >= 1 && graphs == false) printf("bundle cache %s was built with other options of building bundles, use its hits\n", file.c_str());
+
+	// totals are stored after the last bundle
+	int64_t p = fin.tellg();
+	fin.seekg(-(int64_t)(sizeof(qlen) + sizeof(qcnt)), ios::end);
+	fin.read((char*)(&qlen), sizeof(qlen));
+	fin.read((char*)(&qcnt), sizeof(qcnt));
+	fin.seekg(p);
+
+	if(fin.fail() || check() == false)
+	{
+		printf("bundle cache %s is corrupted, rebuild it\n", file.c_str());
+		fin.close();
+		return false;
+	}
+
+	num_bundles = 0;
+	num_graphs = 0;
+	return true;
+}
+
+bool bundle_cache::check()
+{
+	// walk over the sections to the end marker, so that a truncated
+	// cache is found before any bundle is assembled from it
+	int64_t p = fin.tellg();
+	fin.seekg(0, ios::end);
+	int64_t e = fin.tellg();
+	fin.seekg(p);
+
+	int64_t h = 3 * sizeof(int32_t) + sizeof(char) + 3 * sizeof(int);
+	int64_t t = sizeof(qlen) + sizeof(qcnt);
+	bool b = false;
+	while(fin.good())
+	{
+		int32_t n = 0;
+		fin.read((char*)(&n), sizeof(n));
+		if(fin.fail()) break;
+		if(n < 0)
+		{
+			b = (n == -1 && (int64_t)(fin.tellg()) + t == e);
+			break;
+		}
+
+		int64_t l = 0;
+		fin.seekg(h, ios::cur);
+		fin.read((char*)(&l), sizeof(l));
+		if(fin.fail() || l < 0 || (int64_t)(fin.tellg()) + l > e) break;
+		fin.seekg(l, ios::cur);
+
+		char flag = 0;
+		fin.read(&flag, sizeof(flag));
+		if(fin.fail() || flag == 0) continue;
+
+		fin.read((char*)(&l), sizeof(l));
+		if(fin.fail() || l < 0 || (int64_t)(fin.tellg()) + l > e) break;
+		fin.seekg(l, ios::cur);
+	}
+
+	fin.clear();
+	fin.seekg(p);
+	return b;
+}
+
+int bundle_cache::read(bundle &bd, bool &built)
+{
+	// return 0 with bd filled, or -1 after the last bundle; if built,
+	// bd.gr and bd.hs are those saved, and hits are only read if
+	// they are needed for the coverage of samples
+	int32_t n = 0;
+	fin.read((char*)(&n), sizeof(n));
+	if(fin.good() && n == -1) return -1;
+	if(fin.fail() || n < 0) return corrupted();
+
+	bd.clear();
+	bd.gr.clear();
+	bd.hs.clear();
+	fin.read((char*)(&bd.tid), sizeof(bd.tid));
+	fin.read((char*)(&bd.lpos), sizeof(bd.lpos));
+	fin.read((char*)(&bd.rpos), sizeof(bd.rpos));
+	fin.read((char*)(&bd.strand), sizeof(bd.strand));
+	fin.read((char*)(&bd.num_long_reads), sizeof(bd.num_long_reads));
+	fin.read((char*)(&bd.num_reads), sizeof(bd.num_reads));
+	fin.read((char*)(&bd.num_thinned_hits), sizeof(bd.num_thinned_hits));
+
+	int64_t lh = 0;
+	fin.read((char*)(&lh), sizeof(lh));
+	int64_t ph = fin.tellg();
+	fin.seekg(ph + lh);
+
+	char flag = 0;
+	fin.read(&flag, sizeof(flag));
+
+	built = false;
+	if(fin.good() && flag == 1)
+	{
+		int64_t lg = 0;
+		fin.read((char*)(&lg), sizeof(lg));
+		int64_t pg = fin.tellg();
+		if(graphs == true && bd.gr.load(fin) == 0 && bd.hs.load(fin) == 0) built = true;
+		fin.seekg(pg + lg);
+	}
+	int64_t pe = fin.tellg();
+
+	if(fin.good() && (built == false || cfg->sample_coverage == true))
+	{
+		fin.seekg(ph);
+		read_hits(bd, n);
+		fin.seekg(pe);
+	}
+
+	if(fin.fail()) return corrupted();
+
+	num_bundles++;
+	if(built == true) num_graphs++;
+	return 0;
+}
+
+int bundle_cache::corrupted()
+{
+	// the structure was checked by open_read, so a failure here
+	// means corrupted content; bundles were assembled from it
+	// already, so the run cannot fall back to the input files
+	printf("error: bundle cache %s is corrupted, removed; run again to rebuild it\n", file.c_str());
+	fin.close();
+	remove(file.c_str());
+	exit(1);
+	return -1;
+}
+
+int bundle_cache::read_hits(bundle &bd, int n)
+{
+	bd.hits.reserve(n);
+	for(int i = 0; i < n && fin.good(); i++)
+	{
+		bd.hits.push_back(hit(fin, *cfg));
+		bd.hit_bytes += bd.hits.back().memory_usage();
+	}
+
+	read_map(bd.mmap);
+	read_map(bd.imap);
+	return 0;
+}
+
+int bundle_cache::open_write()
+{
+	key = make_key();
+	if(key == "") return -1;
+
+	string tmp = file + ".tmp";
+	fout.open(tmp.c_str(), ios::binary);
+	if(fout.fail())
+	{
+		printf("open bundle cache %s error\n", tmp.c_str());
+		return -1;
+	}
+
+	bkey = make_bundle_key();
+	fout << "scallop-bundle-cache 2\n";
+	fout << key << "\n";
+	fout << bkey << "\n";
+	num_bundles = 0;
+	return 0;
+}
+
+int bundle_cache::write_hits(const bundle_base &bb)
+{
+	// hits of bb must be in memory, see bundle_base::restore;
+	// every bundle is then completed by write_graph
+	if(fout.is_open() == false) return 0;
+
+	int32_t n = bb.hits.size();
+	fout.write((const char*)(&n), sizeof(n));
+	fout.write((const char*)(&bb.tid), sizeof(bb.tid));
+	fout.write((const char*)(&bb.lpos), sizeof(bb.lpos));
+	fout.write((const char*)(&bb.rpos), sizeof(bb.rpos));
+	fout.write((const char*)(&bb.strand), sizeof(bb.strand));
+	fout.write((const char*)(&bb.num_long_reads), sizeof(bb.num_long_reads));
+	fout.write((const char*)(&bb.num_reads), sizeof(bb.num_reads));
+	fout.write((const char*)(&bb.num_thinned_hits), sizeof(bb.num_thinned_hits));
+
+	int64_t p = begin_section();
+	for(int i = 0; i < bb.hits.size(); i++) bb.hits[i].write(fout);
+	write_map(bb.mmap);
+	write_map(bb.imap);
+	end_section(p);
+
+	num_bundles++;
+	return 0;
+}
+
+int bundle_cache::write_graph(const bundle *bd)
+{
+	// bd is NULL if the bundle could not be built
+	if(fout.is_open() == false) return 0;
+
+	char flag = (bd == NULL) ? 0 : 1;
+	fout.write(&flag, sizeof(flag));
+	if(bd == NULL) return 0;
+
+	int64_t p = begin_section();
+	bd->gr.save(fout);
+	bd->hs.save(fout);
+	end_section(p);
+	return 0;
+}
+
+int64_t bundle_cache::begin_section()
+{
+	// a section is preceded by its length, so that it can be skipped
+	int64_t l = 0;
+	fout.write((const char*)(&l), sizeof(l));
+	return fout.tellp();
+}
+
+int bundle_cache::end_section(int64_t p)
+{
+	int64_t e = fout.tellp();
+	int64_t l = e - p;
+	fout.seekp(p - sizeof(l));
+	fout.write((const char*)(&l), sizeof(l));
+	fout.seekp(e);
+	return 0;
+}
+
+int bundle_cache::close_write(double ql, int qc)
+{
+	if(fout.is_open() == false) return 0;
+
+	int32_t n = -1;
+	fout.write((const char*)(&n), sizeof(n));
+	fout.write((const char*)(&ql), sizeof(ql));
+	fout.write((const char*)(&qc), sizeof(qc));
+
+	bool b = (fout.fail() == false);
+	fout.close();
+
+	// renamed only when complete, as checkpoints are
+	string tmp = file + ".tmp";
+	if(b == false || rename(tmp.c_str(), file.c_str()) != 0)
+	{
+		printf("write bundle cache %s error\n", file.c_str());
+		remove(tmp.c_str());
+		return -1;
+	}
+
+	if(cfg->verbose >= 1) printf("bundle cache: %d bundles and their graphs saved to %s\n", num_bundles, file.c_str());
+	return 0;
+}
+
+int bundle_cache::discard()
+{
+	if(fin.is_open() == true) fin.close();
+	if(fout.is_open() == false) return 0;
+	fout.close();
+	string tmp = file + ".tmp";
+	remove(tmp.c_str());
+	return 0;
+}
+
+int bundle_cache::write_map(const split_interval_map &imap)
+{
+	int32_t n = imap.iterative_size();
+	fout.write((const char*)(&n), sizeof(n));
+	for(SIMI it = imap.begin(); it != imap.end(); it++)
+	{
+		int32_t v[3] = {lower(it->first), upper(it->first), it->second};
+		fout.write((const char*)(v), sizeof(v));
+	}
+	return 0;
+}
+
+int bundle_cache::read_map(split_interval_map &imap)
+{
+	// intervals are disjoint and sorted, so they stay split as written
+	int32_t n = 0;
+	fin.read((char*)(&n), sizeof(n));
+	for(int i = 0; i < n && fin.good(); i++)
+	{
+		int32_t v[3];
+		fin.read((char*)(v), sizeof(v));
+		imap += make_pair(ROI(v[0], v[1]), v[2]);
+	}
+	return 0;
+}
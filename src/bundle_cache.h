@@ -0,0 +1,68 @@
+/*
+Part of Scallop Transcript Assembler
+(c) 2017 by  Mingfu Shao, Carl Kingsford, and Carnegie Mellon University.
+See LICENSE for licensing.
+*/
+
+#ifndef __BUNDLE_CACHE_H__
+#define __BUNDLE_CACHE_H__
+
+#include <stdint.h>
+#include <fstream>
+#include <string>
+
+#include "bundle_base.h"
+#include "bundle.h"
+
+using namespace std;
+
+// bundles collected from the input files, saved to disk so that a
+// later run with the same inputs and the same options of collecting
+// reads can skip decoding the alignments; the file is only valid
+// if its key matches, see make_key; the splice graph and hyper-set
+// built for a bundle are saved with its hits, and are used instead
+// of building the bundle again if the options of bundle::build
+// match too, see make_bundle_key
+class bundle_cache
+{
+public:
+	bundle_cache(const parameters *_cfg);
+	~bundle_cache();
+
+private:
+	const parameters *cfg;
+	string file;			// cache file, written to file.tmp first
+	string key;				// identity of inputs and options
+	string bkey;			// options of bundle::build
+	bool graphs;			// whether saved graphs are used
+	ofstream fout;
+	ifstream fin;
+
+public:
+	int num_bundles;		// number of bundles written or read
+	int num_graphs;			// number of saved graphs used
+	double qlen;			// total length of reads, read from the cache
+	int qcnt;				// total number of reads, read from the cache
+
+public:
+	bool open_read();
+	int read(bundle &bd, bool &built);
+	int open_write();
+	int write_hits(const bundle_base &bb);
+	int write_graph(const bundle *bd);
+	int close_write(double ql, int qc);
+	int discard();
+
+private:
+	string make_key() const;
+	string make_bundle_key() const;
+	bool check();
+	int corrupted();
+	int64_t begin_section();
+	int end_section(int64_t p);
+	int read_hits(bundle &bd, int n);
+	int write_map(const split_interval_map &imap);
+	int read_map(split_interval_map &imap);
+};
+
+#endif
@@ -14,70 +14,120 @@ See LICENSE for licensing.
 
 using namespace std;
 
-//// parameters
-// for bam file and reads
-int min_flank_length = 3;
-int max_edit_distance = 10;
-int32_t min_bundle_gap = 50;
-int min_num_hits_in_bundle = 20;
-uint32_t min_mapping_quality = 1;
-int32_t min_splice_boundary_hits = 1;
-bool use_second_alignment = false;
-bool uniquely_mapped_only = false;
-int library_type = EMPTY;
-
-// for preview
-int max_preview_reads = 2000000;
-int max_preview_spliced_reads = 50000;
-int min_preview_spliced_reads = 10000;
-double preview_infer_ratio = 0.95;
-bool preview_only = false;
-
-// for identifying subgraphs
-int32_t min_subregion_gap = 3;
-double min_subregion_overlap = 1.5;
-int32_t min_subregion_length = 15;
-
-// for revising/decomposing splice graph
-double max_intron_contamination_coverage = 2.0;
-double min_surviving_edge_weight = 1.5;
-double max_decompose_error_ratio[7] = {0.33, 0.05, 0.0, 0.25, 0.30, 0.0, 1.1};
-
-// for selecting paths
-double min_transcript_coverage = 1.01;
-double min_transcript_coverage_ratio = 0.005;
-double min_single_exon_coverage = 20;
-double min_transcript_numreads = 20;
-int min_transcript_length_base = 150;
-int min_transcript_length_increase = 50;
-int min_exon_length = 20;
-int max_num_exons = 1000;
-
-// for subsetsum and router
-int max_dp_table_size = 10000;
-int min_router_count = 1;
-
-// for simulation
-int simulation_num_vertices = 0;
-int simulation_num_edges = 0;
-int simulation_max_edge_weight = 0;
-
-// input and output
-string algo = "scallop";
-string input_file;
-string ref_file;
-string ref_file1;
-string ref_file2;
-string output_file;
-
-// for controling
-bool output_tex_files = false;
-string fixed_gene_name = "";
-int batch_bundle_size = 100;
-int verbose = 1;
 string version = "v0.10.3";
 
-int parse_arguments(int argc, const char ** argv)
+parameters::parameters()
+{
+	// for bam file and reads
+	min_flank_length = 3;
+	max_edit_distance = 10;
+	min_bundle_gap = 50;
+	min_num_hits_in_bundle = 20;
+	min_mapping_quality = 1;
+	min_splice_boundary_hits = 1;
+	use_second_alignment = false;
+	uniquely_mapped_only = false;
+	collapse_identical_hits = false;
+	max_hits_in_bundle = 0;
+	max_rare_junction_hits = 10;
+	library_type = EMPTY;
+
+	// for preview
+	max_preview_reads = 2000000;
+	max_preview_spliced_reads = 50000;
+	min_preview_spliced_reads = 10000;
+	preview_infer_ratio = 0.95;
+	preview_only = false;
+
+	// for identifying subgraphs
+	min_subregion_gap = 3;
+	min_subregion_overlap = 1.5;
+	min_subregion_length = 15;
+	use_dense_coverage = false;
+
+	// for revising/decomposing splice graph
+	max_intron_contamination_coverage = 2.0;
+	min_surviving_edge_weight = 1.5;
+	max_decompose_error_ratio[0] = 0.33;
+	max_decompose_error_ratio[1] = 0.05;
+	max_decompose_error_ratio[2] = 0.0;
+	max_decompose_error_ratio[3] = 0.25;
+	max_decompose_error_ratio[4] = 0.30;
+	max_decompose_error_ratio[5] = 0.0;
+	max_decompose_error_ratio[6] = 1.1;
+
+	// for selecting paths
+	min_transcript_coverage = 1.01;
+	min_transcript_coverage_ratio = 0.005;
+	min_single_exon_coverage = 20;
+	min_transcript_numreads = 20;
+	min_transcript_length_base = 150;
+	min_transcript_length_increase = 50;
+	min_exon_length = 20;
+	max_num_exons = 1000;
+	max_decompose_seconds = 0;
+	max_decompose_rounds = 0;
+
+	// for subsetsum and router
+	max_dp_table_size = 10000;
+	min_router_count = 1;
+
+	// for simulation
+	simulation_num_vertices = 0;
+	simulation_num_edges = 0;
+	simulation_max_edge_weight = 0;
+
+	// input and output
+	algo = "scallop";
+
+	// for controling
+	output_tex_files = false;
+	fixed_gene_name = "";
+	batch_bundle_size = 100;
+	max_memory = 0;
+	max_bundle_seconds = 0;
+	max_bundle_memory = 0;
+	quarantine_file = "";
+	checkpoint_interval = 0;
+	resume = false;
+	sample_coverage = false;
+	sweep_file = "";
+	bundle_cache_file = "";
+	regions_file = "";
+	num_threads = 1;
+	verbose = 1;
+}
+
+int parameters::parse_arguments(int argc, const char ** argv)
+{
+	arguments.clear();
+	for(int i = 1; i < argc; i++) arguments.push_back(argv[i]);
+
+	parse_options(argc, argv);
+
+	// verify arguments
+	if(input_file == "")
+	{
+		printf("error: input-file is missing.\n");
+		exit(0);
+	}
+
+	// several sorted inputs are separated by commas
+	input_files.clear();
+	stringstream sstr(input_file);
+	string s;
+	while(getline(sstr, s, ',')) if(s != "") input_files.push_back(s);
+
+	if(output_file == "" && preview_only == false)
+	{
+		printf("error: output-file is missing.\n");
+		exit(0);
+	}
+
+	return 0;
+}
+
+int parameters::parse_options(int argc, const char ** argv)
 {
 	for(int i = 1; i < argc; i++)
 	{
@@ -207,6 +257,13 @@ int parse_arguments(int argc, const char ** argv)
 			min_subregion_overlap = atof(argv[i + 1]);
 			i++;
 		}
+		else if(string(argv[i]) == "--use_dense_coverage")
+		{
+			string s(argv[i + 1]);
+			if(s == "true") use_dense_coverage = true;
+			else use_dense_coverage = false;
+			i++;
+		}
 		else if(string(argv[i]) == "--min_surviving_edge_weight")
 		{
 			min_surviving_edge_weight = atof(argv[i + 1]);
@@ -258,6 +315,16 @@ int parse_arguments(int argc, const char ** argv)
 			max_num_exons = atoi(argv[i + 1]);
 			i++;
 		}
+		else if(string(argv[i]) == "--max_decompose_seconds")
+		{
+			max_decompose_seconds = atof(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--max_decompose_rounds")
+		{
+			max_decompose_rounds = atoi(argv[i + 1]);
+			i++;
+		}
 		else if(string(argv[i]) == "--max_dp_table_size")
 		{
 			max_dp_table_size = atoi(argv[i + 1]);
@@ -326,6 +393,23 @@ int parse_arguments(int argc, const char ** argv)
 			else uniquely_mapped_only = false;
 			i++;
 		}
+		else if(string(argv[i]) == "--collapse_identical_hits")
+		{
+			string s(argv[i + 1]);
+			if(s == "true") collapse_identical_hits = true;
+			else collapse_identical_hits = false;
+			i++;
+		}
+		else if(string(argv[i]) == "--max_hits_in_bundle")
+		{
+			max_hits_in_bundle = atoi(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--max_rare_junction_hits")
+		{
+			max_rare_junction_hits = atoi(argv[i + 1]);
+			i++;
+		}
 		else if(string(argv[i]) == "--verbose")
 		{
 			verbose = atoi(argv[i + 1]);
@@ -336,6 +420,62 @@ int parse_arguments(int argc, const char ** argv)
 			batch_bundle_size = atoi(argv[i + 1]);
 			i++;
 		}
+		else if(string(argv[i]) == "--num_threads")
+		{
+			num_threads = atoi(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--max_bundle_seconds")
+		{
+			max_bundle_seconds = atof(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--max_bundle_memory")
+		{
+			max_bundle_memory = atof(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--quarantine_file")
+		{
+			quarantine_file = string(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--checkpoint_interval")
+		{
+			checkpoint_interval = atof(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--resume")
+		{
+			resume = true;
+		}
+		else if(string(argv[i]) == "--sample_coverage")
+		{
+			string s(argv[i + 1]);
+			if(s == "true") sample_coverage = true;
+			else sample_coverage = false;
+			i++;
+		}
+		else if(string(argv[i]) == "--max_memory")
+		{
+			max_memory = atof(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--sweep")
+		{
+			sweep_file = string(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--bundle_cache")
+		{
+			bundle_cache_file = string(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--regions")
+		{
+			regions_file = string(argv[i + 1]);
+			i++;
+		}
 	}
 
 	if(min_surviving_edge_weight < 0.1 + min_transcript_coverage) 
@@ -343,23 +483,101 @@ int parse_arguments(int argc, const char ** argv)
 		min_surviving_edge_weight = 0.1 + min_transcript_coverage;
 	}
 
-	// verify arguments
-	if(input_file == "")
+	return 0;
+}
+
+int parameters::build_sweep(vector<parameters> &v) const
+{
+	v.clear();
+	if(sweep_file == "") return 0;
+
+	ifstream fin(sweep_file.c_str());
+	if(fin.fail())
 	{
-		printf("error: input-file is missing.\n");
+		printf("error: cannot open sweep file %s\n", sweep_file.c_str());
 		exit(0);
 	}
 
-	if(output_file == "" && preview_only == false)
+	// each line holds the options of one setting, applied after
+	// those of the command line, as if they were appended to it
+	string line;
+	while(getline(fin, line))
 	{
-		printf("error: output-file is missing.\n");
-		exit(0);
+		vector<string> tokens;
+		stringstream sstr(line);
+		string s;
+		while(sstr >> s) tokens.push_back(s);
+		if(tokens.size() == 0 || tokens[0][0] == '#') continue;
+
+		vector<const char*> args;
+		args.push_back("scallop");
+		for(int i = 0; i < arguments.size(); i++) args.push_back(arguments[i].c_str());
+		for(int i = 0; i < tokens.size(); i++) args.push_back(tokens[i].c_str());
+
+		parameters p;
+		p.parse_options(args.size(), args.data());
+		p.input_files = input_files;
+		p.arguments = arguments;
+
+		// the library type inferred by the previewer is inherited only
+		// if not given; a different one is rejected by same_ingest below
+		if(p.library_type == EMPTY) p.library_type = library_type;
+
+		// settings without their own -o are numbered from 1
+		if(p.output_file == output_file)
+		{
+			string name = tostring(v.size() + 1);
+			int k = output_file.size() - 4;
+			if(k >= 0 && output_file.substr(k) == ".gtf") p.output_file = output_file.substr(0, k) + "." + name + ".gtf";
+			else p.output_file = output_file + "." + name;
+		}
+
+		if(same_ingest(p) == false)
+		{
+			printf("error: sweep setting %lu (%s) changes how reads are collected\n", v.size() + 1, line.c_str());
+			exit(0);
+		}
+
+		v.push_back(p);
 	}
 
 	return 0;
 }
 
-int print_parameters()
+bool parameters::same_ingest(const parameters &p) const
+{
+	// options used before bundles are built
+	if(input_file != p.input_file) return false;
+	if(regions_file != p.regions_file) return false;
+	if(library_type != p.library_type) return false;
+	if(min_flank_length != p.min_flank_length) return false;
+	if(min_bundle_gap != p.min_bundle_gap) return false;
+	if(min_num_hits_in_bundle != p.min_num_hits_in_bundle) return false;
+	if(min_mapping_quality != p.min_mapping_quality) return false;
+	if(uniquely_mapped_only != p.uniquely_mapped_only) return false;
+	if(use_second_alignment != p.use_second_alignment) return false;
+	if(collapse_identical_hits != p.collapse_identical_hits) return false;
+	if(max_hits_in_bundle != p.max_hits_in_bundle) return false;
+	if(max_rare_junction_hits != p.max_rare_junction_hits) return false;
+	return true;
+}
+
+bool parameters::same_bundle(const parameters &p) const
+{
+	// options used by bundle::build
+	if(same_ingest(p) == false) return false;
+	if(min_splice_boundary_hits != p.min_splice_boundary_hits) return false;
+	if(min_subregion_gap != p.min_subregion_gap) return false;
+	if(min_subregion_overlap != p.min_subregion_overlap) return false;
+	if(min_subregion_length != p.min_subregion_length) return false;
+	if(use_dense_coverage != p.use_dense_coverage) return false;
+	if(max_intron_contamination_coverage != p.max_intron_contamination_coverage) return false;
+	if(min_surviving_edge_weight != p.min_surviving_edge_weight) return false;
+	if(min_exon_length != p.min_exon_length) return false;
+	return true;
+}
+
+int parameters::print_parameters() const
 {
 	printf("parameters:\n");
 
@@ -370,6 +588,8 @@ int print_parameters()
 	printf("min_num_hits_in_bundle = %d\n", min_num_hits_in_bundle);
 	printf("min_mapping_quality = %d\n", min_mapping_quality);
 	printf("min_splice_boundary_hits = %d\n", min_splice_boundary_hits);
+	printf("max_hits_in_bundle = %d\n", max_hits_in_bundle);
+	printf("max_rare_junction_hits = %d\n", max_rare_junction_hits);
 
 	// for preview
 	printf("preview_only = %c\n", preview_only ? 'T' : 'F');
@@ -382,6 +602,7 @@ int print_parameters()
 	printf("min_subregion_gap = %d\n", min_subregion_gap);
 	printf("min_subregion_length = %d\n", min_subregion_length);
 	printf("min_subregion_overlap = %.2lf\n", min_subregion_overlap);
+	printf("use_dense_coverage = %c\n", use_dense_coverage ? 'T' : 'F');
 
 	// for splice graph
 	printf("max_intron_contamination_coverage = %.2lf\n", max_intron_contamination_coverage);
@@ -393,6 +614,8 @@ int print_parameters()
 	printf("min_transcript_length_base = %d\n", min_transcript_length_base);
 	printf("min_transcript_length_increase = %d\n", min_transcript_length_increase);
 	printf("max_num_exons = %d\n", max_num_exons);
+	printf("max_decompose_seconds = %.2lf\n", max_decompose_seconds);
+	printf("max_decompose_rounds = %d\n", max_decompose_rounds);
 
 	// for subsetsum and router
 	printf("max_dp_table_size = %d\n", max_dp_table_size);
@@ -417,8 +640,20 @@ int print_parameters()
 	printf("fixed_gene_name = %s\n", fixed_gene_name.c_str());
 	printf("use_second_alignment = %c\n", use_second_alignment ? 'T' : 'F');
 	printf("uniquely_mapped_only = %c\n", uniquely_mapped_only ? 'T' : 'F');
+	printf("collapse_identical_hits = %c\n", collapse_identical_hits ? 'T' : 'F');
 	printf("verbose = %d\n", verbose);
 	printf("batch_bundle_size = %d\n", batch_bundle_size);
+	printf("max_memory = %.1lf\n", max_memory);
+	printf("max_bundle_seconds = %.2lf\n", max_bundle_seconds);
+	printf("max_bundle_memory = %.1lf\n", max_bundle_memory);
+	printf("quarantine_file = %s\n", quarantine_file.c_str());
+	printf("checkpoint_interval = %.1lf\n", checkpoint_interval);
+	printf("resume = %c\n", resume ? 'T' : 'F');
+	printf("sample_coverage = %c\n", sample_coverage ? 'T' : 'F');
+	printf("sweep_file = %s\n", sweep_file.c_str());
+	printf("bundle_cache_file = %s\n", bundle_cache_file.c_str());
+	printf("regions_file = %s\n", regions_file.c_str());
+	printf("num_threads = %d\n", num_threads);
 
 	printf("\n");
 
@@ -458,7 +693,7 @@ int print_logo()
 int print_help()
 {
 	printf("\n");
-	printf("Usage: scallop -i <bam-file> -o <gtf-file> [options]\n");
+	printf("Usage: scallop -i <bam-file>[,<bam-file>...] -o <gtf-file> [options]\n");
 	printf("\n");
 	printf("Options:\n");
 	printf(" %-42s  %s\n", "--help",  "print usage of Scallop and exit");
@@ -475,6 +710,21 @@ int print_help()
 	printf(" %-42s  %s\n", "--min_num_hits_in_bundle <integer>",  "minimum number of reads required in a bundle, default: 20");
 	printf(" %-42s  %s\n", "--min_flank_length <integer>",  "minimum match length in each side for a spliced read, default: 3");
 	printf(" %-42s  %s\n", "--min_splice_bundary_hits <integer>",  "minimum number of spliced reads required for a junction, default: 1");
+	printf(" %-42s  %s\n", "--num_threads <integer>",  "number of threads used for assembling subgraphs, default: 1");
+	printf(" %-42s  %s\n", "--max_memory <float>",  "memory (in MB) for reads of open bundles before spilling to disk (a bundle is loaded in full when assembled), 0 to disable, default: 0");
+	printf(" %-42s  %s\n", "--max_bundle_seconds <float>",  "abort and quarantine bundles taking longer than this, 0 to disable, default: 0");
+	printf(" %-42s  %s\n", "--max_bundle_memory <float>",  "abort and quarantine bundles growing memory (in MB) beyond this, 0 to disable, default: 0");
+	printf(" %-42s  %s\n", "--quarantine_file <filename>",  "file listing aborted bundles, default: <gtf-file>.quarantine.tsv");
+	printf(" %-42s  %s\n", "--checkpoint_interval <float>",  "seconds between checkpoints written to <gtf-file>.ckpt, BAM only, 0 to disable, default: 0");
+	printf(" %-42s  %s\n", "--resume",  "continue from <gtf-file>.ckpt if it exists");
+	printf(" %-42s  %s\n", "--sweep <filename>",  "read once and assemble with each line of options in this file, writing <gtf-file> numbered per line");
+	printf(" %-42s  %s\n", "--regions <filename>",  "assemble only the bundles reaching the regions of this BED file, requires indexed input");
+	printf(" %-42s  %s\n", "--bundle_cache <filename>",  "reuse bundles saved in this file by a run on the same input, or save them there");
+	printf(" %-42s  %s\n", "--sample_coverage <true, false>",  "report coverage of each input file as sample_cov in the gtf, default: false");
+	printf(" %-42s  %s\n", "--max_hits_in_bundle <integer>",  "keep a uniform sample of at most this many hits per bundle, with weights scaled up, 0 to disable, default: 0");
+	printf(" %-42s  %s\n", "--max_rare_junction_hits <integer>",  "reads are always kept while one of their junctions has fewer hits, default: 10");
+	printf(" %-42s  %s\n", "--max_decompose_seconds <float>",  "time for decomposing a splice graph before falling back to greedy, 0 to disable, default: 0");
+	printf(" %-42s  %s\n", "--max_decompose_rounds <integer>",  "rounds for decomposing a splice graph before falling back to greedy, 0 to disable, default: 0");
 	return 0;
 }
 
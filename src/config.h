@@ -42,73 +42,105 @@ using namespace std;
 #define FR_SECOND 2
 
 //// parameters
-// for bam file and reads
-extern int min_flank_length;
-extern int max_edit_distance;
-extern int32_t min_bundle_gap;
-extern int min_num_hits_in_bundle;
-extern uint32_t min_mapping_quality;
-extern int32_t min_splice_boundary_hits;
-extern bool uniquely_mapped_only;
-extern bool use_second_alignment;
-
-// for preview
-extern bool preview_only;
-extern int max_preview_reads;
-extern int max_preview_spliced_reads;
-extern int min_preview_spliced_reads;
-extern double preview_infer_ratio;
-
-// for identifying subgraphs
-extern int32_t min_subregion_gap;
-extern double min_subregion_overlap;
-extern int32_t min_subregion_length;
-extern int min_subregion_ladders;
-
-// for subsetsum and router
-extern int max_dp_table_size;
-extern int min_router_count;
-
-// for splice graph
-extern double max_intron_contamination_coverage;
-extern double min_surviving_edge_weight;
-extern double max_decompose_error_ratio[7];
-extern double min_transcript_numreads;
-extern double min_transcript_coverage;
-extern double min_single_exon_coverage;
-extern double min_transcript_coverage_ratio; 
-extern int min_transcript_length_base;
-extern int min_transcript_length_increase;
-extern int min_exon_length;
-extern int max_num_exons;
-
-// for simulation
-extern int simulation_num_vertices;
-extern int simulation_num_edges;
-extern int simulation_max_edge_weight;
-
-// input and output
-extern string algo;
-extern string input_file;
-extern string ref_file;
-extern string ref_file1;
-extern string ref_file2;
-extern string output_file;
-
-// for controling
-extern bool output_tex_files;
-extern string fixed_gene_name;
-extern int max_num_bundles;
-extern int library_type;
-extern int min_gtf_transcripts_num;
-extern int batch_bundle_size;
-extern int verbose;
+// all options of one assembly; objects taking part in
+// an assembly keep a pointer to the parameters they use
+class parameters
+{
+public:
+	parameters();
+
+public:
+	// for bam file and reads
+	int min_flank_length;
+	int max_edit_distance;
+	int32_t min_bundle_gap;
+	int min_num_hits_in_bundle;
+	uint32_t min_mapping_quality;
+	int32_t min_splice_boundary_hits;
+	bool uniquely_mapped_only;
+	bool use_second_alignment;
+	bool collapse_identical_hits;
+	int max_hits_in_bundle;
+	int max_rare_junction_hits;
+
+	// for preview
+	bool preview_only;
+	int max_preview_reads;
+	int max_preview_spliced_reads;
+	int min_preview_spliced_reads;
+	double preview_infer_ratio;
+
+	// for identifying subgraphs
+	int32_t min_subregion_gap;
+	double min_subregion_overlap;
+	int32_t min_subregion_length;
+	bool use_dense_coverage;
+
+	// for subsetsum and router
+	int max_dp_table_size;
+	int min_router_count;
+
+	// for splice graph
+	double max_intron_contamination_coverage;
+	double min_surviving_edge_weight;
+	double max_decompose_error_ratio[7];
+	double min_transcript_numreads;
+	double min_transcript_coverage;
+	double min_single_exon_coverage;
+	double min_transcript_coverage_ratio;
+	int min_transcript_length_base;
+	int min_transcript_length_increase;
+	int min_exon_length;
+	int max_num_exons;
+	double max_decompose_seconds;
+	int max_decompose_rounds;
+
+	// for simulation
+	int simulation_num_vertices;
+	int simulation_num_edges;
+	int simulation_max_edge_weight;
+
+	// input and output
+	string algo;
+	string input_file;
+	vector<string> input_files;
+	string ref_file;
+	string ref_file1;
+	string ref_file2;
+	string output_file;
+
+	// for controling
+	bool output_tex_files;
+	string fixed_gene_name;
+	int library_type;
+	int batch_bundle_size;
+	double max_memory;
+	double max_bundle_seconds;
+	double max_bundle_memory;
+	string quarantine_file;
+	double checkpoint_interval;
+	bool resume;
+	bool sample_coverage;
+	string sweep_file;
+	string bundle_cache_file;
+	string regions_file;
+	int num_threads;
+	int verbose;
+	vector<string> arguments;	// command line, replayed for sweep settings
+
+public:
+	int parse_arguments(int argc, const char ** argv);
+	int parse_options(int argc, const char ** argv);
+	int build_sweep(vector<parameters> &v) const;
+	bool same_ingest(const parameters &p) const;
+	bool same_bundle(const parameters &p) const;
+	int print_parameters() const;
+};
+
 extern string version;
 
 // parse arguments
 int print_command_line(int argc, const char ** argv);
-int parse_arguments(int argc, const char ** argv);
-int print_parameters();
 int print_copyright();
 int print_logo();
 int print_help();
@@ -0,0 +1,103 @@
+/*
+Part of Scallop Transcript Assembler
+(c) 2017 by  Mingfu Shao, Carl Kingsford, and Carnegie Mellon University.
+See LICENSE for licensing.
+*/
+
+#include <cassert>
+#include <cmath>
+
+#include "coverage.h"
+
+coverage::coverage()
+{
+	lpos = 0;
+	rpos = 0;
+}
+
+int coverage::clear()
+{
+	lpos = 0;
+	rpos = 0;
+	cov.clear();
+	return 0;
+}
+
+int coverage::build(const split_interval_map &mmap, int32_t l, int32_t r)
+{
+	assert(l <= r);
+	lpos = l;
+	rpos = r;
+
+	// difference array over the nodes, then prefix sums
+	cov.assign(r - l + 1, 0);
+	for(SIMI it = mmap.begin(); it != mmap.end(); it++)
+	{
+		int32_t p1 = lower(it->first);
+		int32_t p2 = upper(it->first);
+		if(p1 < l) p1 = l;
+		if(p2 > r) p2 = r;
+		if(p1 >= p2) continue;
+		cov[p1 - l] += it->second;
+		cov[p2 - l] -= it->second;
+	}
+
+	for(int i = 1; i < cov.size(); i++) cov[i] += cov[i - 1];
+	cov.pop_back();
+
+	return 0;
+}
+
+int64_t coverage::sum(int32_t p1, int32_t p2) const
+{
+	assert(p1 >= lpos && p2 <= rpos);
+	const int32_t *x = &cov[0] + (p1 - lpos);
+	int n = p2 - p1;
+
+	int64_t s = 0;
+	for(int i = 0; i < n; i++) s += x[i];
+	return s;
+}
+
+int coverage::evaluate_rectangle(int32_t ll, int32_t rr, double &ave, double &dev) const
+{
+	// same as evaluate_rectangle on the interval map,
+	// uncovered bases do not contribute to the deviation
+	ave = 0;
+	dev = 1.0;
+
+	int64_t s = sum(ll, rr);
+	if(s == 0) return 0;
+
+	ave = 1.0 * s / (rr - ll);
+
+	const int32_t *x = &cov[0] + (ll - lpos);
+	int n = rr - ll;
+
+	double var = 0;
+	for(int i = 0; i < n; i++)
+	{
+		double d = x[i] - ave;
+		var += (x[i] != 0) ? d * d : 0;
+	}
+
+	dev = sqrt(var / (rr - ll));
+	return 0;
+}
+
+int coverage::covered_intervals(int32_t p1, int32_t p2, vector<PI32> &v) const
+{
+	// maximal runs of covered bases in [p1, p2)
+	v.clear();
+	int32_t p = -1;
+	for(int32_t i = p1; i < p2; i++)
+	{
+		bool b = (cov[i - lpos] != 0);
+		if(b == true && p < 0) p = i;
+		if(b == true || p < 0) continue;
+		v.push_back(PI32(p, i));
+		p = -1;
+	}
+	if(p >= 0) v.push_back(PI32(p, p2));
+	return 0;
+}
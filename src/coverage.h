@@ -0,0 +1,38 @@
+/*
+Part of Scallop Transcript Assembler
+(c) 2017 by  Mingfu Shao, Carl Kingsford, and Carnegie Mellon University.
+See LICENSE for licensing.
+*/
+
+#ifndef __COVERAGE_H__
+#define __COVERAGE_H__
+
+#include <stdint.h>
+#include <vector>
+
+#include "util.h"
+#include "interval_map.h"
+
+using namespace std;
+
+// dense per-base coverage of a bundle, an alternative
+// to iterating the nodes of the matched interval map
+class coverage
+{
+public:
+	coverage();
+
+public:
+	int32_t lpos;					// position of cov[0]
+	int32_t rpos;					// cov covers [lpos, rpos)
+	vector<int32_t> cov;			// per-base coverage
+
+public:
+	int build(const split_interval_map &mmap, int32_t l, int32_t r);
+	int clear();
+	int64_t sum(int32_t p1, int32_t p2) const;
+	int evaluate_rectangle(int32_t ll, int32_t rr, double &ave, double &dev) const;
+	int covered_intervals(int32_t p1, int32_t p2, vector<PI32> &v) const;
+};
+
+#endif
@@ -8,14 +8,16 @@ See LICENSE for licensing.
 #define __FILTER_H__
 
 #include "gene.h"
+#include "config.h"
 
 class filter
 {
 public:
-	filter(const vector<transcript> &v);
+	filter(const vector<transcript> &v, const parameters &_cfg);
 
 public:
 	vector<transcript> trs;
+	const parameters *cfg;
 
 public:
 	int join_single_exon_transcripts();
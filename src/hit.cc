@@ -31,20 +31,31 @@ hit::hit(int32_t p)
 
 hit& hit::operator=(const hit &h)
 {
+	if(this == &h) return *this;
+
 	bam1_core_t::operator=(h);
 	rpos = h.rpos;
 	qlen = h.qlen;
 	qname = h.qname;
 	strand = h.strand;
-	spos = h.spos;
 	xs = h.xs;
 	ts = h.ts;
+	nh = h.nh;
 	hi = h.hi;
 	nm = h.nm;
 	is_long_read = h.is_long_read;
+	weight = h.weight;
+	sample = h.sample;
 
-	cigar = new uint32_t[h.n_cigar];
-	memcpy(cigar, h.cigar, 4 * h.n_cigar);
+	// cigar is never modified, so copies share the buffer
+	cigar_buf = h.cigar_buf;
+	cigar = h.cigar;
+	itvs = h.itvs;
+	spos = h.spos;
+	n_matched = h.n_matched;
+	n_inserted = h.n_inserted;
+	n_deleted = h.n_deleted;
+	n_spos = h.n_spos;
 	return *this;
 }
 
@@ -55,26 +66,91 @@ hit::hit(const hit &h)
 	qlen = h.qlen;
 	qname = h.qname;
 	strand = h.strand;
-	spos = h.spos;
 	xs = h.xs;
 	ts = h.ts;
+	nh = h.nh;
 	hi = h.hi;
 	nm = h.nm;
 	is_long_read = h.is_long_read;
+	weight = h.weight;
+	sample = h.sample;
 
 	//printf("call copy constructor\n");
-	cigar = new uint32_t[h.n_cigar];
-	memcpy(cigar, h.cigar, 4 * h.n_cigar);
-	//printf("n-cigar = %d, h.n_cigar = %d, size of cigar = %lu | %u\n", n_cigar, h.n_cigar, sizeof cigar, sizeof h.cigar);
+	cigar_buf = h.cigar_buf;
+	cigar = h.cigar;
+	itvs = h.itvs;
+	spos = h.spos;
+	n_matched = h.n_matched;
+	n_inserted = h.n_inserted;
+	n_deleted = h.n_deleted;
+	n_spos = h.n_spos;
 }
 
 hit::~hit()
 {
-	assert(cigar != NULL);
-	delete[] cigar;
 }
 
-hit::hit(bam1_t *b)
+int hit::allocate_cigar()
+{
+	// one buffer holds the decoded intervals and splice positions,
+	// at most one per operation, followed by the cigar itself
+	int n = n_cigar + (n_cigar + 1) / 2;
+	cigar_buf = shared_ptr<int64_t>(new int64_t[n], default_delete<int64_t[]>());
+	itvs = cigar_buf.get();
+	cigar = (uint32_t*)(itvs + n_cigar);
+	spos = itvs;
+	n_matched = n_inserted = n_deleted = n_spos = 0;
+	return 0;
+}
+
+int hit::decode_cigar(const parameters &cfg)
+{
+	// a single pass computes rpos, qlen, the matched, inserted
+	// and deleted intervals and the splice positions
+	int64_t vi[MAX_NUM_CIGAR];
+	int64_t vd[MAX_NUM_CIGAR];
+	int64_t vs[MAX_NUM_CIGAR];
+	int nm = 0, ni = 0, nd = 0, ns = 0;
+
+	int32_t p = pos;
+	int32_t q = 0;
+	for(int k = 0; k < n_cigar; k++)
+	{
+		int op = bam_cigar_op(cigar[k]);
+		int32_t len = bam_cigar_oplen(cigar[k]);
+		if(bam_cigar_type(op) & 2) p += len;
+		if(bam_cigar_type(op) & 1) q += len;
+
+		if(op == BAM_CMATCH) itvs[nm++] = pack(p - len, p);
+		else if(op == BAM_CINS) vi[ni++] = pack(p - 1, p + 1);
+		else if(op == BAM_CDEL) vd[nd++] = pack(p - len, p);
+		else if(op == BAM_CREF_SKIP)
+		{
+			if(k == 0 || k == n_cigar - 1) continue;
+			if(bam_cigar_op(cigar[k - 1]) != BAM_CMATCH) continue;
+			if(bam_cigar_op(cigar[k + 1]) != BAM_CMATCH) continue;
+			if(bam_cigar_oplen(cigar[k - 1]) < cfg.min_flank_length) continue;
+			if(bam_cigar_oplen(cigar[k + 1]) < cfg.min_flank_length) continue;
+			vs[ns++] = pack(p - len, p);
+		}
+	}
+
+	assert(nm + ni + nd + ns <= n_cigar);
+	if(ni >= 1) memcpy(itvs + nm, vi, 8 * ni);
+	if(nd >= 1) memcpy(itvs + nm + ni, vd, 8 * nd);
+	spos = itvs + nm + ni + nd;
+	if(ns >= 1) memcpy(spos, vs, 8 * ns);
+
+	n_matched = nm;
+	n_inserted = ni;
+	n_deleted = nd;
+	n_spos = ns;
+	rpos = p;
+	qlen = q;
+	return 0;
+}
+
+hit::hit(bam1_t *b, const parameters &cfg)
 	:bam1_core_t(b->core)
 {
 	// fetch query name
@@ -84,35 +160,129 @@ hit::hit(bam1_t *b)
 	memcpy(buf, q, l);
 	buf[l] = '\0';
 	qname = string(buf);
+	weight = 1;
+	sample = 0;
 
 	string sub = qname.substr(0, 10);
 	if(sub == "SRR1020625") is_long_read = false;
 	else is_long_read = true;
 
-	// compute rpos
-	rpos = pos + (int32_t)bam_cigar2rlen(n_cigar, bam_get_cigar(b));
-	qlen = (int32_t)bam_cigar2qlen(n_cigar, bam_get_cigar(b));
-
 	// copy cigar
 	assert(n_cigar <= MAX_NUM_CIGAR);
 	assert(n_cigar >= 1);
 
 	// allocate memery for cigar
-	cigar = new uint32_t[n_cigar];
+	allocate_cigar();
 	memcpy(cigar, bam_get_cigar(b), 4 * n_cigar);
 
+	// compute rpos, qlen, intervals and splice positions
+	decode_cigar(cfg);
+
 	//printf("call regular constructor\n");
 }
 
+hit::hit(ifstream &fin, const parameters &cfg)
+{
+	// read a hit written by hit::write
+	fin.read((char*)(static_cast<bam1_core_t*>(this)), sizeof(bam1_core_t));
+	fin.read((char*)(&strand), sizeof(strand));
+	fin.read((char*)(&xs), sizeof(xs));
+	fin.read((char*)(&ts), sizeof(ts));
+	fin.read((char*)(&nh), sizeof(nh));
+	fin.read((char*)(&hi), sizeof(hi));
+	fin.read((char*)(&nm), sizeof(nm));
+	fin.read((char*)(&is_long_read), sizeof(is_long_read));
+	fin.read((char*)(&weight), sizeof(weight));
+	fin.read((char*)(&sample), sizeof(sample));
+
+	int32_t l = 0;
+	fin.read((char*)(&l), sizeof(l));
+
+	// a truncated or corrupted stream leaves an empty hit and 
+	// fin failed; callers check fin after reading each hit
+	if(fin.fail() || l < 0 || l > 255 || n_cigar > MAX_NUM_CIGAR)
+	{
+		fin.setstate(ios::failbit);
+		n_cigar = 0;
+		l = 0;
+	}
+
+	qname.resize(l);
+	if(l >= 1) fin.read(&qname[0], l);
+
+	allocate_cigar();
+	fin.read((char*)(cigar), 4 * n_cigar);
+	if(fin.fail()) n_cigar = 0;
+	decode_cigar(cfg);
+}
+
+int hit::write(ofstream &fout) const
+{
+	// compact binary record, read back by hit(ifstream&)
+	fout.write((const char*)(static_cast<const bam1_core_t*>(this)), sizeof(bam1_core_t));
+	fout.write((const char*)(&strand), sizeof(strand));
+	fout.write((const char*)(&xs), sizeof(xs));
+	fout.write((const char*)(&ts), sizeof(ts));
+	fout.write((const char*)(&nh), sizeof(nh));
+	fout.write((const char*)(&hi), sizeof(hi));
+	fout.write((const char*)(&nm), sizeof(nm));
+	fout.write((const char*)(&is_long_read), sizeof(is_long_read));
+	fout.write((const char*)(&weight), sizeof(weight));
+	fout.write((const char*)(&sample), sizeof(sample));
+
+	int32_t l = qname.size();
+	fout.write((const char*)(&l), sizeof(l));
+	fout.write(qname.c_str(), l);
+
+	// intervals and splice positions are decoded again when read
+	fout.write((const char*)(cigar), 4 * n_cigar);
+	return 0;
+}
+
+int64_t hit::memory_usage() const
+{
+	// the shared cigar buffer is split among its owners
+	return sizeof(hit) + 8 * (n_cigar + (n_cigar + 1) / 2) / cigar_buf.use_count() + qname.capacity();
+}
+
 int hit::set_tags(bam1_t *b)
 {
+	// one pass over the aux data instead of a bam_aux_get 
+	// per tag, each of which rescans from the first tag
 	ts = '.';
-	uint8_t *p0 = bam_aux_get(b, "ts");
-	if(p0 && (*p0) == 'A') ts = bam_aux2A(p0);
-
 	xs = '.';
-	uint8_t *p1 = bam_aux_get(b, "XS");
-	if(p1 && (*p1) == 'A') xs = bam_aux2A(p1);
+	hi = -1;
+	nh = -1;
+	int nm1 = -1, nm2 = -1;		// nM and NM
+
+	uint8_t *s = bam_get_aux(b);
+	uint8_t *e = b->data + b->l_data;
+	while(s + 3 <= e)
+	{
+		char t1 = s[0], t2 = s[1], type = s[2];
+		s += 3;
+
+		if(type == 'A' && s + 1 <= e)
+		{
+			if(t1 == 't' && t2 == 's') ts = (char)(*s);
+			if(t1 == 'X' && t2 == 'S') xs = (char)(*s);
+		}
+		if(type == 'C' && s + 1 <= e)
+		{
+			if(t1 == 'H' && t2 == 'I') hi = *s;
+			if(t1 == 'N' && t2 == 'H') nh = *s;
+			if(t1 == 'n' && t2 == 'M') nm1 = *s;
+			if(t1 == 'N' && t2 == 'M') nm2 = *s;
+		}
+
+		int n = aux_size(type, s, e);
+		if(n < 0) break;
+		s += n;
+	}
+
+	nm = 0;
+	if(nm1 >= 0) nm = nm1;
+	if(nm2 >= 0) nm = nm2;
 
 	if(xs == '.' && ts != '.')
 	{
@@ -123,24 +293,39 @@ int hit::set_tags(bam1_t *b)
 		if((flag & 0x10) <= 0 && ts == '-') xs = '-';
 	}
 
-	hi = -1;
-	uint8_t *p2 = bam_aux_get(b, "HI");
-	if(p2 && (*p2) == 'C') hi = bam_aux2i(p2);
-
-	nh = -1;
-	uint8_t *p3 = bam_aux_get(b, "NH");
-	if(p3 && (*p3) == 'C') nh = bam_aux2i(p3);
-
-	nm = 0;
-	uint8_t *p4 = bam_aux_get(b, "nM");
-	if(p4 && (*p4) == 'C') nm = bam_aux2i(p4);
-
-	uint8_t *p5 = bam_aux_get(b, "NM");
-	if(p5 && (*p5) == 'C') nm = bam_aux2i(p5);
-
 	return 0;
 }
 
+int hit::aux_size(char type, const uint8_t *s, const uint8_t *e)
+{
+	// bytes taken by the value of an aux field, -1 if malformed
+	switch(type)
+	{
+		case 'A': case 'c': case 'C': return 1;
+		case 's': case 'S': return 2;
+		case 'i': case 'I': case 'f': return 4;
+		case 'd': return 8;
+		case 'Z': case 'H':
+		{
+			const uint8_t *p = s;
+			while(p < e && *p != 0) p++;
+			if(p >= e) return -1;
+			return p - s + 1;
+		}
+		case 'B':
+		{
+			if(s + 5 > e) return -1;
+			uint32_t n;
+			memcpy(&n, s + 1, 4);
+			int k = aux_size((char)(s[0]), s, e);
+			if(k < 0 || s[0] == 'B' || s[0] == 'Z' || s[0] == 'H') return -1;
+			if(s + 5 + (int64_t)k * n > e) return -1;
+			return 5 + k * n;
+		}
+	}
+	return -1;
+}
+
 int hit::set_concordance()
 {
 	bool concordant = false;
@@ -151,11 +336,11 @@ int hit::set_concordance()
 	return 0;
 }
 
-int hit::set_strand()
+int hit::set_strand(const parameters &cfg)
 {
 	strand = '.';
 	
-	if(library_type == FR_FIRST && ((flag & 0x1) >= 1))
+	if(cfg.library_type == FR_FIRST && ((flag & 0x1) >= 1))
 	{
 		if((flag & 0x10) <= 0 && (flag & 0x40) >= 1 && (flag & 0x80) <= 0) strand = '-';
 		if((flag & 0x10) >= 1 && (flag & 0x40) >= 1 && (flag & 0x80) <= 0) strand = '+';
@@ -163,7 +348,7 @@ int hit::set_strand()
 		if((flag & 0x10) >= 1 && (flag & 0x40) <= 0 && (flag & 0x80) >= 1) strand = '-';
 	}
 
-	if(library_type == FR_SECOND && ((flag & 0x1) >= 1))
+	if(cfg.library_type == FR_SECOND && ((flag & 0x1) >= 1))
 	{
 		if((flag & 0x10) <= 0 && (flag & 0x40) >= 1 && (flag & 0x80) <= 0) strand = '+';
 		if((flag & 0x10) >= 1 && (flag & 0x40) >= 1 && (flag & 0x80) <= 0) strand = '-';
@@ -171,13 +356,13 @@ int hit::set_strand()
 		if((flag & 0x10) >= 1 && (flag & 0x40) <= 0 && (flag & 0x80) >= 1) strand = '+';
 	}
 
-	if(library_type == FR_FIRST && ((flag & 0x1) <= 0))
+	if(cfg.library_type == FR_FIRST && ((flag & 0x1) <= 0))
 	{
 		if((flag & 0x10) <= 0) strand = '-';
 		if((flag & 0x10) >= 1) strand = '+';
 	}
 
-	if(library_type == FR_SECOND && ((flag & 0x1) <= 0))
+	if(cfg.library_type == FR_SECOND && ((flag & 0x1) <= 0))
 	{
 		if((flag & 0x10) <= 0) strand = '+';
 		if((flag & 0x10) >= 1) strand = '-';
@@ -186,33 +371,6 @@ int hit::set_strand()
 	return 0;
 }
 
-int hit::build_splice_positions()
-{
-	spos.clear();
-	int32_t p = pos;
-	int32_t q = 0;
-	//uint8_t *seq = bam_get_seq(b);
-    for(int k = 0; k < n_cigar; k++)
-	{
-		if (bam_cigar_type(bam_cigar_op(cigar[k]))&2)
-			p += bam_cigar_oplen(cigar[k]);
-
-		if (bam_cigar_type(bam_cigar_op(cigar[k]))&1)
-			q += bam_cigar_oplen(cigar[k]);
-
-		if(k == 0 || k == n_cigar - 1) continue;
-		if(bam_cigar_op(cigar[k]) != BAM_CREF_SKIP) continue;
-		if(bam_cigar_op(cigar[k-1]) != BAM_CMATCH) continue;
-		if(bam_cigar_op(cigar[k+1]) != BAM_CMATCH) continue;
-		if(bam_cigar_oplen(cigar[k-1]) < min_flank_length) continue;
-		if(bam_cigar_oplen(cigar[k+1]) < min_flank_length) continue;
-
-		int32_t s = p - bam_cigar_oplen(cigar[k]);
-		spos.push_back(pack(s, p));
-	}
-	return 0;
-}
-
 bool hit::operator<(const hit &h) const
 {
 	if(qname < h.qname) return true;
@@ -233,11 +391,11 @@ int hit::print() const
 	}
 
 	// print basic information
-	printf("Hit %s: [%d-%d), mpos = %d, cigar = %s, flag = %d, quality = %d, strand = %c, xs = %c, ts = %c, isize = %d, qlen = %d, hi = %d, is-long = %c\n", 
-			qname.c_str(), pos, rpos, mpos, sstr.str().c_str(), flag, qual, strand, xs, ts, isize, qlen, hi, is_long_read ? 'T' : 'F');
+	printf("Hit %s: [%d-%d), mpos = %d, cigar = %s, flag = %d, quality = %d, strand = %c, xs = %c, ts = %c, isize = %d, qlen = %d, hi = %d, is-long = %c, weight = %d\n", 
+			qname.c_str(), pos, rpos, mpos, sstr.str().c_str(), flag, qual, strand, xs, ts, isize, qlen, hi, is_long_read ? 'T' : 'F', weight);
 
 	printf(" start position (%d - )\n", pos);
-	for(int i = 0; i < spos.size(); i++)
+	for(int i = 0; i < n_spos; i++)
 	{
 		int64_t p = spos[i];
 		int32_t p1 = high32(p);
@@ -250,43 +408,32 @@ int hit::print() const
 	return 0;
 }
 
-int hit::get_mid_intervals(vector<int64_t> &vm, vector<int64_t> &vi, vector<int64_t> &vd) const
+int64_t hit::alignment_key() const
 {
-	vm.clear();
-	vi.clear();
-	vd.clear();
-	int32_t p = pos;
-    for(int k = 0; k < n_cigar; k++)
-	{
-		if (bam_cigar_type(bam_cigar_op(cigar[k]))&2)
-		{
-			p += bam_cigar_oplen(cigar[k]);
-		}
-
-		if(bam_cigar_op(cigar[k]) == BAM_CMATCH)
-		{
-			int32_t s = p - bam_cigar_oplen(cigar[k]);
-			vm.push_back(pack(s, p));
-		}
-
-		if(bam_cigar_op(cigar[k]) == BAM_CINS)
-		{
-			vi.push_back(pack(p - 1, p + 1));
-		}
-
-		if(bam_cigar_op(cigar[k]) == BAM_CDEL)
-		{
-			int32_t s = p - bam_cigar_oplen(cigar[k]);
-			vd.push_back(pack(s, p));
-		}
-	}
-    return 0;
+	// hash of the alignment shape; only used to bucket candidates,
+	// identical alignments are verified with same_alignment
+	uint64_t h = 1469598103934665603ull;
+	h = (h ^ (uint32_t)rpos) * 1099511628211ull;
+	h = (h ^ (uint32_t)mpos) * 1099511628211ull;
+	h = (h ^ (uint32_t)isize) * 1099511628211ull;
+	h = (h ^ flag) * 1099511628211ull;
+	h = (h ^ (uint32_t)hi) * 1099511628211ull;
+	h = (h ^ (uint8_t)xs) * 1099511628211ull;
+	for(int k = 0; k < n_cigar; k++) h = (h ^ cigar[k]) * 1099511628211ull;
+	return (int64_t)h;
 }
 
-int hit::get_matched_intervals(vector<int64_t> &v) const
+bool hit::same_alignment(const hit &h) const
 {
-	vector<int64_t> vi, vd;
-	return get_mid_intervals(v, vi, vd);
+	if(tid != h.tid || pos != h.pos || rpos != h.rpos) return false;
+	if(n_cigar != h.n_cigar || flag != h.flag) return false;
+	if(mtid != h.mtid || mpos != h.mpos || isize != h.isize) return false;
+	if(strand != h.strand || xs != h.xs) return false;
+	if(nh != h.nh || hi != h.hi || nm != h.nm) return false;
+	if(is_long_read != h.is_long_read) return false;
+	if(sample != h.sample) return false;
+	if(memcmp(cigar, h.cigar, 4 * n_cigar) != 0) return false;
+	return true;
 }
 
 /*
@@ -9,6 +9,8 @@ See LICENSE for licensing.
 
 #include <string>
 #include <vector>
+#include <fstream>
+#include <memory>
 
 #include "htslib/sam.h"
 #include "config.h"
@@ -45,7 +47,8 @@ class hit: public bam1_core_t
 {
 public:
 	//hit(int32_t p);
-	hit(bam1_t *b);
+	hit(bam1_t *b, const parameters &cfg);
+	hit(ifstream &fin, const parameters &cfg);
 	hit(const hit &h);
 	~hit();
 	bool operator<(const hit &h) const;
@@ -63,17 +66,31 @@ public:
 	int32_t nm;								// NM aux in sam
 	bool concordant;						// whether it is concordant
 	uint32_t* cigar;						// cigar, use samtools
-	vector<int64_t> spos;					// splice positions
+	int64_t* itvs;							// decoded cigar: matched, inserted, deleted intervals
+	int64_t* spos;							// splice positions, following the intervals in itvs
+	uint16_t n_matched;						// number of matched intervals
+	uint16_t n_inserted;					// number of inserted intervals
+	uint16_t n_deleted;						// number of deleted intervals
+	uint16_t n_spos;						// number of splice positions
+	shared_ptr<int64_t> cigar_buf;			// owns cigar and itvs, shared by all copies of this hit
 	bool is_long_read;						// whether this read is long read
+	int32_t weight;							// number of identical alignments collapsed into this hit
+	int32_t sample;							// index of the input file of this hit
 
 public:
+	int allocate_cigar();
+	int decode_cigar(const parameters &cfg);
 	int set_tags(bam1_t *b);
-	int set_strand();
+	int set_strand(const parameters &cfg);
 	int set_concordance();
-	int build_splice_positions();
-	int get_mid_intervals(vector<int64_t> &vm, vector<int64_t> &vi, vector<int64_t> &vd) const;
-	int get_matched_intervals(vector<int64_t> &v) const;
+	int write(ofstream &fout) const;
+	int64_t memory_usage() const;
+	int64_t alignment_key() const;
+	bool same_alignment(const hit &h) const;
 	int print() const;
+
+private:
+	static int aux_size(char type, const uint8_t *s, const uint8_t *e);
 };
 
 //inline bool hit_compare_by_name(const hit &x, const hit &y);
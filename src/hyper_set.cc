@@ -38,20 +38,56 @@ int hyper_set::add_node_list(const vector<int> &s, int c)
 	return 0;
 }
 
-int hyper_set::build(directed_graph &gr, MEI& e2i)
+int hyper_set::save(ofstream &fout) const
 {
-	build_edges(gr, e2i);
+	// only the node lists are saved, edges are built from them
+	int32_t n = nodes.size();
+	fout.write((const char*)(&n), sizeof(n));
+	for(MVII::const_iterator it = nodes.begin(); it != nodes.end(); it++)
+	{
+		int32_t k = it->first.size();
+		int32_t c = it->second;
+		fout.write((const char*)(&k), sizeof(k));
+		fout.write((const char*)(it->first.data()), sizeof(int) * k);
+		fout.write((const char*)(&c), sizeof(c));
+	}
+	return 0;
+}
+
+int hyper_set::load(ifstream &fin)
+{
+	// return -1 if fin is truncated or corrupted
+	clear();
+	int32_t n = 0;
+	fin.read((char*)(&n), sizeof(n));
+	for(int i = 0; i < n && fin.good(); i++)
+	{
+		int32_t k = 0, c = 0;
+		fin.read((char*)(&k), sizeof(k));
+		if(fin.fail() || k < 0 || k > 1048576) return -1;
+		vector<int> v(k);
+		if(k >= 1) fin.read((char*)(v.data()), sizeof(int) * k);
+		fin.read((char*)(&c), sizeof(c));
+		nodes.insert(PVII(v, c));
+	}
+	if(fin.fail()) return -1;
+	return 0;
+}
+
+int hyper_set::build(directed_graph &gr, MEI& e2i, int min_count)
+{
+	build_edges(gr, e2i, min_count);
 	build_index();
 	return 0;
 }
 
-int hyper_set::build_edges(directed_graph &gr, MEI& e2i)
+int hyper_set::build_edges(directed_graph &gr, MEI& e2i, int min_count)
 {
 	edges.clear();
 	for(MVII::iterator it = nodes.begin(); it != nodes.end(); it++)
 	{
 		int c = it->second;
-		if(c < min_router_count) continue;
+		if(c < min_count) continue;
 
 		const vector<int> &vv = it->first;
 		vector<int> ve;
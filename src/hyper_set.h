@@ -10,6 +10,7 @@ See LICENSE for licensing.
 #include <map>
 #include <set>
 #include <vector>
+#include <fstream>
 
 #include "util.h"
 #include "directed_graph.h"
@@ -37,8 +38,8 @@ public:
 	int add_node_list(const set<int> &s);
 	int add_node_list(const set<int> &s, int c);
 	int add_node_list(const vector<int> &s, int c);
-	int build(directed_graph &gr, MEI &e2i);
-	int build_edges(directed_graph &gr, MEI &e2i);
+	int build(directed_graph &gr, MEI &e2i, int min_count);
+	int build_edges(directed_graph &gr, MEI &e2i, int min_count);
 	int build_index();
 	int update_index();
 	set<int> get_intersection(const vector<int> &v);
@@ -46,6 +47,8 @@ public:
 	MI get_predecessors(int e);
 	MPII get_routes(int x, directed_graph &gr, MEI &e2i);
 	int print();
+	int save(ofstream &fout) const;
+	int load(ifstream &fin);
 
 public:
 	int replace(int x, int e);
@@ -32,26 +32,24 @@ int main(int argc, const char **argv)
 		return 0;
 	}
 
-	parse_arguments(argc, argv);
+	parameters cfg;
+	cfg.parse_arguments(argc, argv);
 
-	if(verbose >= 1)
+	if(cfg.verbose >= 1)
 	{
 		print_copyright();
 		printf("\n");
 		print_command_line(argc, argv);
 		printf("\n");
-		//print_parameters();
+		//cfg.print_parameters();
 	}
 
-	if(library_type == EMPTY || preview_only == true)
-	{
-		previewer pv;
-		pv.preview();
-	}
+	previewer pv(cfg);
+	if(cfg.library_type == EMPTY || cfg.preview_only == true) pv.preview();
 
-	if(preview_only == true) return 0;
+	if(cfg.preview_only == true) return 0;
 
-	assembler asmb;
+	assembler asmb(cfg, pv);
 	asmb.assemble();
 
 	return 0;
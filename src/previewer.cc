@@ -5,90 +5,291 @@ See LICENSE for licensing.
 */
 
 #include <cstdio>
+#include <cstdlib>
 #include <cassert>
+#include <cmath>
 #include <sstream>
 
 #include "previewer.h"
+#include "thread_pool.h"
 #include "config.h"
 
-previewer::previewer()
+preview_stats::preview_stats(const parameters *_cfg)
 {
-    sfn = sam_open(input_file.c_str(), "r");
-    hdr = sam_hdr_read(sfn);
-    b1t = bam_init1();
+	cfg = _cfg;
+	total = 0;
+	single = 0;
+	paired = 0;
+}
+
+int preview_stats::add(bam1_t *b)
+{
+	bam1_core_t &p = b->core;
+
+	if((p.flag & 0x4) >= 1) return 0;										// read is not mapped
+	if((p.flag & 0x100) >= 1 && cfg->use_second_alignment == false) return 0;	// qstrandary alignment
+	if(p.n_cigar > MAX_NUM_CIGAR) return 0;									// ignore hits with more than 7 cigar types
+	if(p.qual < cfg->min_mapping_quality) return 0;								// ignore hits with small quality
+	if(p.n_cigar < 1) return 0;												// should never happen
+
+	total++;
+
+	hit ht(b, *cfg);
+	ht.set_tags(b);
+
+	if((ht.flag & 0x1) >= 1) paired ++;
+	if((ht.flag & 0x1) <= 0) single ++;
+
+	if(ht.xs == '.') return 0;
+	if(ht.xs == '+' && sp1.size() >= cfg->max_preview_spliced_reads) return 0;
+	if(ht.xs == '-' && sp2.size() >= cfg->max_preview_spliced_reads) return 0;
+
+	// predicted strand
+	char xs = '.';
+
+	// for paired read
+	if((ht.flag & 0x1) >= 1 && (ht.flag & 0x10) <= 0 && (ht.flag & 0x20) >= 1 && (ht.flag & 0x40) >= 1 && (ht.flag & 0x80) <= 0) xs = '-';
+	if((ht.flag & 0x1) >= 1 && (ht.flag & 0x10) >= 1 && (ht.flag & 0x20) <= 0 && (ht.flag & 0x40) <= 0 && (ht.flag & 0x80) >= 1) xs = '-';
+	if((ht.flag & 0x1) >= 1 && (ht.flag & 0x10) >= 1 && (ht.flag & 0x20) <= 0 && (ht.flag & 0x40) >= 1 && (ht.flag & 0x80) <= 0) xs = '+';
+	if((ht.flag & 0x1) >= 1 && (ht.flag & 0x10) <= 0 && (ht.flag & 0x20) >= 1 && (ht.flag & 0x40) <= 0 && (ht.flag & 0x80) >= 1) xs = '+';
+
+	// for single read
+	if((ht.flag & 0x1) <= 0 && (ht.flag & 0x10) <= 0) xs = '-';
+	if((ht.flag & 0x1) <= 0 && (ht.flag & 0x10) >= 1) xs = '+';
+
+	if(xs == '+' && xs == ht.xs) sp1.push_back(1);
+	if(xs == '-' && xs == ht.xs) sp2.push_back(1);
+	if(xs == '+' && xs != ht.xs) sp1.push_back(2);
+	if(xs == '-' && xs != ht.xs) sp2.push_back(2);
+
+	return 0;
+}
+
+int preview_stats::merge(const preview_stats &s)
+{
+	total += s.total;
+	single += s.single;
+	paired += s.paired;
+	for(int k = 0; k < s.sp1.size() && sp1.size() < cfg->max_preview_spliced_reads; k++) sp1.push_back(s.sp1[k]);
+	for(int k = 0; k < s.sp2.size() && sp2.size() < cfg->max_preview_spliced_reads; k++) sp2.push_back(s.sp2[k]);
+	return 0;
+}
+
+bool preview_stats::full() const
+{
+	if(total >= cfg->max_preview_reads) return true;
+	if(sp1.size() >= cfg->max_preview_spliced_reads && sp2.size() >= cfg->max_preview_spliced_reads) return true;
+	return false;
+}
+
+int preview_stats::count(int &sp, int &first, int &second) const
+{
+	sp = sp1.size() < sp2.size() ? sp1.size() : sp2.size();
+	first = second = 0;
+
+	for(int k = 0; k < sp; k++)
+	{
+		if(sp1[k] == 1) first++;
+		if(sp2[k] == 1) first++;
+		if(sp1[k] == 2) second++;
+		if(sp2[k] == 2) second++;
+	}
+	return 0;
+}
+
+bool preview_stats::decided() const
+{
+	if(full() == true) return true;
+
+	int sp, first, second;
+	count(sp, first, second);
+	if(sp < cfg->min_preview_spliced_reads) return false;
+
+	// stop once the fraction of first-strand reads is three
+	// standard errors away from both thresholds of inference
+	double n = first + second;
+	double q = first / n;
+	double h = 3.0 * sqrt(q * (1.0 - q) / n) + 1.0 / n;
+	double r = cfg->preview_infer_ratio;
+	if(q - h > r) return true;
+	if(q + h < 1.0 - r) return true;
+	if(q + h < r && q - h > 1.0 - r) return true;
+	return false;
+}
+
+previewer::previewer(parameters &_cfg)
+	: stats(&_cfg)
+{
+	cfg = &_cfg;
+	sfn = NULL;
+	hdr = NULL;
+	num_windows = 0;
+	reread = false;
 }
 
 previewer::~previewer()
 {
-    bam_destroy1(b1t);
-    bam_hdr_destroy(hdr);
-    sam_close(sfn);
+	for(int i = 0; i < buf.size(); i++) bam_destroy1(buf[i]);
+	if(hdr != NULL) bam_hdr_destroy(hdr);
+	if(sfn != NULL) sam_close(sfn);
 }
 
 int previewer::preview()
 {
-	int total = 0;
-	int single = 0;
-	int paired = 0;
-
-	int first = 0;
-	int second = 0;
-	vector<int> sp1;
-	vector<int> sp2;
+	sfn = sam_open(cfg->input_files[0].c_str(), "r");
+	if(sfn == NULL)
+	{
+		printf("open input file %s error\n", cfg->input_files[0].c_str());
+		exit(1);
+	}
+	bam_merger::project_fields(sfn);
+	hdr = sam_hdr_read(sfn);
 
-    while(sam_read1(sfn, hdr, b1t) >= 0)
+	// sample windows across the genome if the file is indexed,
+	// otherwise read from the beginning as the assembler does
+	int r = -1;
+	hts_idx_t *idx = sam_index_load(sfn, cfg->input_files[0].c_str());
+	if(idx != NULL)
 	{
-		if(total >= max_preview_reads) break;
-		if(sp1.size() >= max_preview_spliced_reads && sp2.size() >= max_preview_spliced_reads) break;
+		hts_idx_destroy(idx);
+		r = preview_index();
+	}
 
-		bam1_core_t &p = b1t->core;
+	if(r != 0)
+	{
+		stats = preview_stats(cfg);
+		num_windows = 0;
+		preview_sequential();
+	}
 
-		if((p.flag & 0x4) >= 1) continue;										// read is not mapped
-		if((p.flag & 0x100) >= 1 && use_second_alignment == false) continue;	// qstrandary alignment
-		if(p.n_cigar > MAX_NUM_CIGAR) continue;									// ignore hits with more than 7 cigar types
-		if(p.qual < min_mapping_quality) continue;								// ignore hits with small quality
-		if(p.n_cigar < 1) continue;												// should never happen
+	infer();
+	return 0;
+}
 
-		total++;
+int previewer::preview_index()
+{
+	const int m = 4096;				// number of windows
+	const int rounds = 16;			// windows of a round cover the whole genome
+	const int64_t wlen = 20000;		// length of a window
+	int cap = cfg->max_preview_reads / m;
+	if(cap < 100) cap = 100;		// reads taken from one window
 
-		hit ht(b1t);
-		ht.set_tags(b1t);
+	int64_t glen = 0;
+	for(int i = 0; i < hdr->n_targets; i++) glen += hdr->target_len[i];
+	if(glen <= 0) return -1;
 
-		if((ht.flag & 0x1) >= 1) paired ++;
-		if((ht.flag & 0x1) <= 0) single ++;
+	// windows on a regular grid over the concatenated chromosomes
+	vector<int> wt;
+	vector<int64_t> wp;
+	int tid = 0;
+	int64_t offset = 0;
+	for(int i = 0; i < m; i++)
+	{
+		int64_t g = (2 * i + 1) * glen / (2 * m);
+		while(tid < hdr->n_targets && offset + hdr->target_len[tid] <= g) offset += hdr->target_len[tid++];
+		if(tid >= hdr->n_targets) break;
+		wt.push_back(tid);
+		wp.push_back(g - offset);
+	}
 
-		if(ht.xs == '.') continue;
-		if(ht.xs == '+' && sp1.size() >= max_preview_spliced_reads) continue;
-		if(ht.xs == '-' && sp2.size() >= max_preview_spliced_reads) continue;
+	// every worker reads through its own handle and its own index,
+	// as a CRAM index is bound to the handle it is loaded with
+	int n = cfg->num_threads < 1 ? 1 : cfg->num_threads;
+	vector<samFile*> fns(n, NULL);
+	vector<bam_hdr_t*> hds(n, NULL);
+	vector<hts_idx_t*> ids(n, NULL);
+	for(int t = 0; t < n; t++)
+	{
+		fns[t] = sam_open(cfg->input_files[0].c_str(), "r");
+		if(fns[t] == NULL) continue;
+		bam_merger::project_fields(fns[t]);
+		hds[t] = sam_hdr_read(fns[t]);
+		ids[t] = sam_index_load(fns[t], cfg->input_files[0].c_str());
+	}
 
-		// predicted strand
-		char xs = '.';
+	thread_pool workers(n);
+	for(int r = 0; r < rounds && stats.decided() == false; r++)
+	{
+		vector<int> ws;
+		for(int i = r; i < wt.size(); i += rounds) ws.push_back(i);
 
-		// for paired read
-		if((ht.flag & 0x1) >= 1 && (ht.flag & 0x10) <= 0 && (ht.flag & 0x20) >= 1 && (ht.flag & 0x40) >= 1 && (ht.flag & 0x80) <= 0) xs = '-';
-		if((ht.flag & 0x1) >= 1 && (ht.flag & 0x10) >= 1 && (ht.flag & 0x20) <= 0 && (ht.flag & 0x40) <= 0 && (ht.flag & 0x80) >= 1) xs = '-';
-		if((ht.flag & 0x1) >= 1 && (ht.flag & 0x10) >= 1 && (ht.flag & 0x20) <= 0 && (ht.flag & 0x40) >= 1 && (ht.flag & 0x80) <= 0) xs = '+';
-		if((ht.flag & 0x1) >= 1 && (ht.flag & 0x10) <= 0 && (ht.flag & 0x20) >= 1 && (ht.flag & 0x40) <= 0 && (ht.flag & 0x80) >= 1) xs = '+';
+		vector<preview_stats> vs(ws.size(), preview_stats(cfg));
+		workers.run(n, [&](int t)
+		{
+			if(fns[t] == NULL || ids[t] == NULL) return;
+			bam1_t *b = bam_init1();
+			for(int j = t; j < ws.size(); j += n)
+			{
+				int64_t p = wp[ws[j]];
+				hts_itr_t *itr = sam_itr_queryi(ids[t], wt[ws[j]], p, p + wlen);
+				if(itr == NULL) continue;
+				while(vs[j].total < cap && sam_itr_next(fns[t], itr, b) >= 0)
+				{
+					// reads are counted in the window they start in
+					if(b->core.pos < p) continue;
+					vs[j].add(b);
+				}
+				hts_itr_destroy(itr);
+			}
+			bam_destroy1(b);
+		});
 
-		// for single read
-		if((ht.flag & 0x1) <= 0 && (ht.flag & 0x10) <= 0) xs = '-';
-		if((ht.flag & 0x1) <= 0 && (ht.flag & 0x10) >= 1) xs = '+';
+		// merged in window order, so the result does not depend on threads
+		for(int j = 0; j < vs.size(); j++) stats.merge(vs[j]);
+		num_windows += ws.size();
+	}
 
-		if(xs == '+' && xs == ht.xs) sp1.push_back(1);
-		if(xs == '-' && xs == ht.xs) sp2.push_back(1);
-		if(xs == '+' && xs != ht.xs) sp1.push_back(2);
-		if(xs == '-' && xs != ht.xs) sp2.push_back(2);
+	for(int t = 0; t < n; t++)
+	{
+		if(ids[t] != NULL) hts_idx_destroy(ids[t]);
+		if(hds[t] != NULL) bam_hdr_destroy(hds[t]);
+		if(fns[t] != NULL) sam_close(fns[t]);
 	}
 
-	int sp = sp1.size() < sp2.size() ? sp1.size() : sp2.size();
+	// too little evidence in the windows, read the file instead
+	int sp, first, second;
+	stats.count(sp, first, second);
+	if(stats.full() == false && sp < cfg->min_preview_spliced_reads) return -1;
 
-	for(int k = 0; k < sp; k++)
+	return 0;
+}
+
+int previewer::preview_sequential()
+{
+	// records are kept for the assembler unless only previewing; 
+	// past the cap they are dropped and the file is read again
+	int64_t cap = 256ll << 20;
+	if(cfg->max_memory > 0 && cfg->max_memory * 1048576.0 / 4 < cap) cap = (int64_t)(cfg->max_memory * 1048576.0 / 4);
+
+	bool keep = (cfg->preview_only == false);
+	int64_t bytes = 0;
+	bam1_t *b = bam_init1();
+	while(stats.full() == false && sam_read1(sfn, hdr, b) >= 0)
 	{
-		if(sp1[k] == 1) first++;
-		if(sp2[k] == 1) first++;
-		if(sp1[k] == 2) second++;
-		if(sp2[k] == 2) second++;
+		stats.add(b);
+		if(keep == false) continue;
+
+		bytes += sizeof(bam1_t) + b->m_data;
+		if(bytes > cap)
+		{
+			for(int i = 0; i < buf.size(); i++) bam_destroy1(buf[i]);
+			vector<bam1_t*>().swap(buf);
+			keep = false;
+			reread = true;
+			continue;
+		}
+
+		buf.push_back(b);
+		b = bam_init1();
 	}
+	bam_destroy1(b);
+	return 0;
+}
+
+int previewer::infer()
+{
+	int sp, first, second;
+	stats.count(sp, first, second);
 
 	vector<string> vv;
 	vv.push_back("empty");
@@ -97,16 +298,31 @@ int previewer::preview()
 	vv.push_back("second");
 
 	int s1 = UNSTRANDED;
-	if(sp >= min_preview_spliced_reads && first > preview_infer_ratio * 2.0 * sp) s1 = FR_FIRST;
-	if(sp >= min_preview_spliced_reads && second > preview_infer_ratio * 2.0 * sp) s1 = FR_SECOND;
+	if(sp >= cfg->min_preview_spliced_reads && first > cfg->preview_infer_ratio * 2.0 * sp) s1 = FR_FIRST;
+	if(sp >= cfg->min_preview_spliced_reads && second > cfg->preview_infer_ratio * 2.0 * sp) s1 = FR_SECOND;
 
-	if(verbose >= 1)
+	if(cfg->verbose >= 1 && num_windows >= 1) printf("preview: sampled %d windows of the indexed input\n", num_windows);
+	if(cfg->verbose >= 1)
 	{
 		printf("preview: reads = %d, single = %d, paired = %d, spliced reads = %d, first = %d, second = %d, inferred library_type = %s, given library_type = %s\n",
-			total, single, paired, sp, first, second, vv[s1 + 1].c_str(), vv[library_type + 1].c_str());
+			stats.total, stats.single, stats.paired, sp, first, second, vv[s1 + 1].c_str(), vv[cfg->library_type + 1].c_str());
 	}
 
-	if(library_type == EMPTY) library_type = s1;
+	if(cfg->library_type == EMPTY) cfg->library_type = s1;
 
 	return 0;
 }
+
+int previewer::release(bam_merger &reader)
+{
+	// the opened first input and the records read so far are
+	// handed over, so that they are not decoded again, unless
+	// there were too many to keep; reader then opens it anew
+	if(sfn == NULL) return 0;
+	if(reread == true) return 0;
+	reader.adopt(sfn, hdr, buf);
+	sfn = NULL;
+	hdr = NULL;
+	buf.clear();
+	return 0;
+}
@@ -8,25 +8,59 @@ See LICENSE for licensing.
 #define __PREVIEWER_H__
 
 #include "hit.h"
+#include "bam_merger.h"
 
 #include <fstream>
 #include <string>
+#include <vector>
 
 using namespace std;
 
+// strand evidence collected from a set of reads
+class preview_stats
+{
+public:
+	preview_stats(const parameters *_cfg);
+
+public:
+	const parameters *cfg;	// limits of previewing
+	int total;				// number of usable reads
+	int single;				// number of single-end reads
+	int paired;				// number of paired-end reads
+	vector<int> sp1;		// spliced reads on +, 1: first, 2: second
+	vector<int> sp2;		// spliced reads on -, 1: first, 2: second
+
+public:
+	int add(bam1_t *b);
+	int merge(const preview_stats &s);
+	bool full() const;
+	int count(int &sp, int &first, int &second) const;
+	bool decided() const;
+};
+
 class previewer
 {
 public:
-	previewer();
+	previewer(parameters &_cfg);
 	~previewer();
 
 private:
+	parameters *cfg;		// library_type is set here
 	samFile *sfn;
 	bam_hdr_t *hdr;
-	bam1_t *b1t;
+	vector<bam1_t*> buf;	// records read without an index, replayed by assembler
+	preview_stats stats;
+	int num_windows;		// number of windows sampled with the index
+	bool reread;			// records read exceeded the cap of buf
 
 public:
 	int preview();
+	int release(bam_merger &reader);
+
+private:
+	int preview_index();
+	int preview_sequential();
+	int infer();
 };
 
 #endif
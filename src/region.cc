@@ -11,8 +11,8 @@ See LICENSE for licensing.
 
 using namespace std;
 
-region::region(int32_t _lpos, int32_t _rpos, int _ltype, int _rtype, const split_interval_map *_mmap, const split_interval_map *_imap)
-	:lpos(_lpos), rpos(_rpos), mmap(_mmap), imap(_imap), ltype(_ltype), rtype(_rtype)
+region::region(int32_t _lpos, int32_t _rpos, int _ltype, int _rtype, const split_interval_map *_mmap, const split_interval_map *_imap, const coverage *_cvg, const parameters *_cfg)
+	:lpos(_lpos), rpos(_rpos), mmap(_mmap), imap(_imap), cvg(_cvg), cfg(_cfg), ltype(_ltype), rtype(_rtype)
 {
 
 	build_join_interval_map();
@@ -28,6 +28,14 @@ int region::build_join_interval_map()
 {
 	jmap.clear();
 
+	if(cvg != NULL)
+	{
+		vector<PI32> v;
+		cvg->covered_intervals(lpos, rpos, v);
+		for(int i = 0; i < v.size(); i++) jmap += make_pair(ROI(v[i].first, v[i].second), 1);
+		return 0;
+	}
+
 	SIMI lit, rit;
 	tie(lit, rit) = locate_boundary_iterators(*mmap, lpos, rpos);
 	if(lit == mmap->end() || rit == mmap->end()) return 0;
@@ -82,8 +90,8 @@ int region::split_join_interval_map()
 
 		double ave1 = -1, ave2 = -1;
 		double dev1 = -1, dev2 = -1;
-		evaluate_rectangle(*mmap, lpos, p, ave1, dev1);
-		evaluate_rectangle(*mmap, q, rpos, ave2, dev2);
+		evaluate_rectangle(lpos, p, ave1, dev1);
+		evaluate_rectangle(q, rpos, ave2, dev2);
 
 		if(ave1 < min_split_boundary_coverage) b = false;
 		if(ave2 < min_split_boundary_coverage) b = false;
@@ -105,7 +113,7 @@ int region::split_join_interval_map()
 
 int region::smooth_join_interval_map()
 {
-	int32_t gap = min_subregion_gap;
+	int32_t gap = cfg->min_subregion_gap;
 	vector<PI32> v;
 	int32_t p = lpos;
 	for(JIMI it = jmap.begin(); it != jmap.end(); it++)
@@ -138,7 +146,14 @@ bool region::empty_subregion(int32_t p1, int32_t p2)
 	assert(p1 >= lpos && p2 <= rpos);
 
 	//printf(" region = [%d, %d), subregion [%d, %d), length = %d\n", lpos, rpos, p1, p2, p2 - p1);
-	if(p2 - p1 < min_subregion_length) return true;
+	if(p2 - p1 < cfg->min_subregion_length) return true;
+
+	if(cvg != NULL)
+	{
+		double r = cvg->sum(p1, p2) * 1.0 / (p2 - p1);
+		if(r < cfg->min_subregion_overlap) return true;
+		return false;
+	}
 
 	SIMI it1, it2;
 	tie(it1, it2) = locate_boundary_iterators(*mmap, p1, p2);
@@ -147,8 +162,8 @@ bool region::empty_subregion(int32_t p1, int32_t p2)
 	int32_t sum = compute_sum_overlap(*mmap, it1, it2);
 	double ratio = sum * 1.0 / (p2 - p1);
 	//printf(" region = [%d, %d), subregion [%d, %d), overlap = %.2lf\n", lpos, rpos, p1, p2, ratio);
-	//if(ratio < min_subregion_overlap + max_intron_contamination_coverage) return true;
-	if(ratio < min_subregion_overlap) return true;
+	//if(ratio < cfg->min_subregion_overlap + cfg->max_intron_contamination_coverage) return true;
+	if(ratio < cfg->min_subregion_overlap) return true;
 
 	return false;
 }
@@ -164,7 +179,7 @@ int region::build_partial_exons()
 	if(lower(jmap.begin()->first) == lpos && upper(jmap.begin()->first) == rpos)
 	{
 		partial_exon pe(lpos, rpos, ltype, rtype);
-		evaluate_rectangle(*mmap, pe.lpos, pe.rpos, pe.ave, pe.dev);
+		evaluate_rectangle(pe.lpos, pe.rpos, pe.ave, pe.dev);
 		pexons.push_back(pe);
 		return 0;
 	}
@@ -196,7 +211,7 @@ int region::build_partial_exons()
 		int rt = (p2 == rpos) ? rtype : END_BOUNDARY;
 
 		partial_exon pe(p1, p2, lt, rt);
-		evaluate_rectangle(*mmap, pe.lpos, pe.rpos, pe.ave, pe.dev);
+		evaluate_rectangle(pe.lpos, pe.rpos, pe.ave, pe.dev);
 		pexons.push_back(pe);
 	}
 
@@ -211,6 +226,12 @@ int region::build_partial_exons()
 	return 0;
 }
 
+int region::evaluate_rectangle(int32_t p1, int32_t p2, double &ave, double &dev) const
+{
+	if(cvg != NULL) return cvg->evaluate_rectangle(p1, p2, ave, dev);
+	return ::evaluate_rectangle(*mmap, p1, p2, ave, dev);
+}
+
 bool region::left_inclusive()
 {
 	if(pexons.size() == 0) return false;
@@ -10,7 +10,9 @@ See LICENSE for licensing.
 #include <stdint.h>
 #include <vector>
 #include "interval_map.h"
+#include "config.h"
 #include "partial_exon.h"
+#include "coverage.h"
 
 using namespace std;
 
@@ -19,7 +21,7 @@ typedef pair<int, int> PI;
 class region
 {
 public:
-	region(int32_t _lpos, int32_t _rpos, int _ltype, int _rtype, const split_interval_map *_mmap, const split_interval_map *_imap);
+	region(int32_t _lpos, int32_t _rpos, int _ltype, int _rtype, const split_interval_map *_mmap, const split_interval_map *_imap, const coverage *_cvg, const parameters *_cfg);
 	~region();
 
 public:
@@ -29,6 +31,8 @@ public:
 	int rtype;						// type of the right boundary
 	const split_interval_map *mmap;	// pointer to match interval map
 	const split_interval_map *imap;	// pointer to indel interval map
+	const coverage *cvg;			// pointer to dense coverage, NULL if not used
+	const parameters *cfg;			// parameters of the assembly
 	join_interval_map jmap;			// subregion intervals
 
 	vector<partial_exon> pexons;	// generated partial exons
@@ -44,6 +48,7 @@ private:
 	int split_join_interval_map();
 	bool empty_subregion(int32_t p1, int32_t p2);
 	int build_partial_exons();
+	int evaluate_rectangle(int32_t p1, int32_t p2, double &ave, double &dev) const;
 };
 
 #endif
@@ -74,7 +74,8 @@ int router::classify()
 
 	build_indices();
 	build_bipartite_graph();
-	vector< set<int> > vv = ug.compute_connected_components();
+	vector<int> v;
+	int nc = ug.assign_connected_components(v);
 
 	if(routes.size() == 0)
 	{
@@ -83,15 +84,13 @@ int router::classify()
 		return 0;
 	}
 
-	if(vv.size() == 1)
+	if(nc == 1)
 	{
 		type = UNSPLITTABLE_SINGLE;
-		degree = ug.num_edges() - ug.num_vertices() + vv.size() + vv.size();
+		degree = ug.num_edges() - ug.num_vertices() + nc + nc;
 		return 0;
 	}
 
-	vector<int> v = ug.assign_connected_components();
-
 	bool b1 = true;
 	bool b2 = true;
 	for(int i = 1; i < gr.in_degree(root); i++)
@@ -106,12 +105,12 @@ int router::classify()
 	if(b1 == true || b2 == true)
 	{
 		type = UNSPLITTABLE_MULTIPLE;
-		degree = ug.num_edges() - ug.num_vertices() + vv.size() + vv.size();
+		degree = ug.num_edges() - ug.num_vertices() + nc + nc;
 		return 0;
 	}
 
 	type = SPLITTABLE_HYPER;
-	degree = vv.size() - 1;
+	degree = nc - 1;
 	return 0;
 }
 
@@ -239,57 +238,17 @@ int router::extend_bipartite_graph_all()
 
 int router::build_maximum_spanning_tree()
 {
+	// Kruskal: scan edges by decreasing weight and
+	// keep those joining two different components
 	if(ug.num_vertices() == 0) return 0;
 	vector<PED> vew(u2w.begin(), u2w.end());
 	sort(vew.begin(), vew.end(), compare_edge_weight);
-	set<int> sv;
-	sv.insert(0);
-	SE se;
-
-	vector< set<int> > vv = ug.compute_connected_components();
-	for(int i = 0; i < vv.size(); i++)
-	{
-		set<int> &s = vv[i];
-		if(s.size() == 0) continue;
-		sv.insert(*(s.begin()));
-	}
-
-	/*
-	printf("------\n");
-	for(int i = 0; i < vew.size(); i++)
-	{
-		edge_descriptor e = vew[i].first;
-		int s = e->source();
-		int t = e->target();
-		printf("graph edge (%d, %d), weight = %.3lf\n", s, t, vew[i].second);
-	}
-	*/
-
-	while(true)
-	{
-		bool b = false;
-		for(int i = 0; i < vew.size(); i++)
-		{
-			edge_descriptor e = vew[i].first;
-			if(se.find(e) != se.end()) continue;
-			int s = e->source();
-			int t = e->target();
-			if(sv.find(s) == sv.end() && sv.find(t) == sv.end()) continue;
-			if(sv.find(s) != sv.end() && sv.find(t) != sv.end()) continue;
-			sv.insert(s);
-			sv.insert(t);
-			se.insert(e);
-			b = true;
-			//printf("add   edge (%d, %d), weight = %.3lf\n", s, t, vew[i].second);
-			break;
-		}
-		if(b == false) break;
-	}
 
+	disjoint_set ds(ug.num_vertices());
 	for(int i = 0; i < vew.size(); i++)
 	{
 		edge_descriptor e = vew[i].first;
-		if(se.find(e) != se.end()) continue;
+		if(ds.join(e->source(), e->target()) == true) continue;
 		ug.remove_edge(e);
 		u2w.erase(e);
 	}
@@ -5,6 +5,7 @@ See LICENSE for licensing.
 */
 
 #include "scallop.h"
+#include "bottleneck_path.h"
 #include "config.h"
 
 #include <cstdio>
@@ -14,59 +15,84 @@ See LICENSE for licensing.
 #include <algorithm>
 
 scallop::scallop()
-{}
+{
+	round = 0;
+	budget_exceeded = false;
+	guard = NULL;
+	aborted = false;
+	cfg = NULL;
+}
+
+scallop::scallop(const splice_graph &g, const hyper_set &h, const parameters &c)
+	: gr(g), hs(h), cfg(&c)
+{
+	init();
+}
+
+scallop::scallop(splice_graph &&g, hyper_set &&h, const parameters &c)
+	: gr(std::move(g)), hs(std::move(h)), cfg(&c)
+{
+	init();
+}
+
+scallop::~scallop()
+{
+}
 
-scallop::scallop(const splice_graph &g, const hyper_set &h)
-	: gr(g), hs(h)
+int scallop::init()
 {
 	round = 0;
-	if(output_tex_files == true) gr.draw(gr.gid + "." + tostring(round++) + ".tex");
+	budget_exceeded = false;
+	guard = NULL;
+	aborted = false;
+	if(cfg->output_tex_files == true) gr.draw(gr.gid + "." + tostring(round++) + ".tex");
 
 	gr.get_edge_indices(i2e, e2i);
 	//add_pseudo_hyper_edges();
-	hs.build(gr, e2i);
+	hs.build(gr, e2i, cfg->min_router_count);
 	init_super_edges();
 	init_vertex_map();
 	init_inner_weights();
 	init_nonzeroset();
-}
-
-scallop::~scallop()
-{
+	return 0;
 }
 
 int scallop::assemble()
 {
 	int c = classify();
-	if(verbose >= 1) printf("process splice graph %s type = %d, vertices = %lu, edges = %lu, phasing paths = %lu\n", gr.gid.c_str(), c, gr.num_vertices(), gr.num_edges(), hs.edges.size());
+	if(cfg->verbose >= 1) printf("process splice graph %s type = %d, vertices = %lu, edges = %lu, phasing paths = %lu\n", gr.gid.c_str(), c, gr.num_vertices(), gr.num_edges(), hs.edges.size());
 
-	//resolve_negligible_edges(false, max_decompose_error_ratio[NEGLIGIBLE_EDGE]);
+	//resolve_negligible_edges(false, cfg->max_decompose_error_ratio[NEGLIGIBLE_EDGE]);
 
+	int rounds = 0;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
 	while(true)
 	{	
-		if(gr.num_vertices() > max_num_exons) break;
+		if(gr.num_vertices() > cfg->max_num_exons) break;
+		if(exceed_budget(start, rounds++) == true) break;
+		if(check_guard() == true) return -1;
 
 		bool b = false;
 
-		b = resolve_trivial_vertex_fast(max_decompose_error_ratio[TRIVIAL_VERTEX]);
+		b = resolve_trivial_vertex_fast(cfg->max_decompose_error_ratio[TRIVIAL_VERTEX]);
 		if(b == true) continue;
 
-		b = resolve_trivial_vertex(1, max_decompose_error_ratio[TRIVIAL_VERTEX]);
+		b = resolve_trivial_vertex(1, cfg->max_decompose_error_ratio[TRIVIAL_VERTEX]);
 		if(b == true) continue;
 
 		b = resolve_unsplittable_vertex(UNSPLITTABLE_SINGLE, 1, -0.5);
 		if(b == true) continue;
 
-		b = resolve_smallest_edges(max_decompose_error_ratio[SMALLEST_EDGE]);
+		b = resolve_smallest_edges(cfg->max_decompose_error_ratio[SMALLEST_EDGE]);
 		if(b == true) continue;
 
-		b = resolve_negligible_edges(true, max_decompose_error_ratio[NEGLIGIBLE_EDGE]);
+		b = resolve_negligible_edges(true, cfg->max_decompose_error_ratio[NEGLIGIBLE_EDGE]);
 		if(b == true) continue;
 
 		b = resolve_unsplittable_vertex(UNSPLITTABLE_MULTIPLE, 1, -0.5);
 		if(b == true) continue;
 
-		b = resolve_splittable_vertex(SPLITTABLE_HYPER, 1, max_decompose_error_ratio[SPLITTABLE_HYPER]);
+		b = resolve_splittable_vertex(SPLITTABLE_HYPER, 1, cfg->max_decompose_error_ratio[SPLITTABLE_HYPER]);
 		if(b == true) continue;
 
 		b = resolve_unsplittable_vertex(UNSPLITTABLE_SINGLE, INT_MAX, -0.5);
@@ -75,7 +101,7 @@ int scallop::assemble()
 		b = resolve_unsplittable_vertex(UNSPLITTABLE_MULTIPLE, INT_MAX, -0.5);
 		if(b == true) continue;
 
-		b = resolve_unsplittable_vertex(UNSPLITTABLE_SINGLE, INT_MAX, max_decompose_error_ratio[UNSPLITTABLE_SINGLE]);
+		b = resolve_unsplittable_vertex(UNSPLITTABLE_SINGLE, INT_MAX, cfg->max_decompose_error_ratio[UNSPLITTABLE_SINGLE]);
 		if(b == true) continue;
 
 		b = resolve_hyper_edge(2);
@@ -89,7 +115,7 @@ int scallop::assemble()
 
 		//summarize_vertices();
 
-		b = resolve_trivial_vertex(2, max_decompose_error_ratio[TRIVIAL_VERTEX]);
+		b = resolve_trivial_vertex(2, cfg->max_decompose_error_ratio[TRIVIAL_VERTEX]);
 		if(b == true) continue;
 
 		break;
@@ -97,11 +123,12 @@ int scallop::assemble()
 
 	collect_existing_st_paths();
 	greedy_decompose();
+	if(aborted == true) return -1;
 
 	trsts.clear();
 	gr.output_transcripts(trsts, paths);
 
-	if(verbose >= 2) 
+	if(cfg->verbose >= 2) 
 	{
 		for(int i = 0; i < paths.size(); i++) paths[i].print(i);
 		printf("finish assemble bundle %s\n\n", gr.gid.c_str());
@@ -110,6 +137,32 @@ int scallop::assemble()
 	return 0;
 }
 
+bool scallop::exceed_budget(const chrono::steady_clock::time_point &start, int rounds)
+{
+	if(cfg->max_decompose_rounds <= 0 && cfg->max_decompose_seconds <= 0) return false;
+
+	chrono::duration<double> d = chrono::steady_clock::now() - start;
+	double t = d.count();
+
+	bool b = false;
+	if(cfg->max_decompose_rounds > 0 && rounds >= cfg->max_decompose_rounds) b = true;
+	if(cfg->max_decompose_seconds > 0 && t >= cfg->max_decompose_seconds) b = true;
+	if(b == false) return false;
+
+	budget_exceeded = true;
+	if(cfg->verbose >= 1) printf("splice graph %s exceeds decomposing budget after %d rounds and %.2lf seconds, remaining vertices = %lu, switch to greedy decomposing\n", 
+			gr.gid.c_str(), rounds, t, nonzeroset.size());
+	return true;
+}
+
+bool scallop::check_guard()
+{
+	if(guard == NULL) return false;
+	if(guard->expired() == false) return false;
+	aborted = true;
+	return true;
+}
+
 bool scallop::resolve_smallest_edges(double max_ratio)
 {
 	int se = -1;
@@ -146,7 +199,7 @@ bool scallop::resolve_smallest_edges(double max_ratio)
 		if(r < 0.01)
 		{
 			double w = gr.get_edge_weight(i2e[e]);
-			if(verbose >= 2) printf("resolve small edge, edge = %d, weight = %.2lf, ratio = %.2lf, vertex = (%d, %d), degree = (%d, %d)\n", 
+			if(cfg->verbose >= 2) printf("resolve small edge, edge = %d, weight = %.2lf, ratio = %.2lf, vertex = (%d, %d), degree = (%d, %d)\n", 
 					e, w, r, s, t, gr.out_degree(s), gr.in_degree(t));
 
 			remove_edge(e);
@@ -168,7 +221,7 @@ bool scallop::resolve_smallest_edges(double max_ratio)
 	double sw = gr.get_edge_weight(i2e[se]);
 	int s = i2e[se]->source();
 	int t = i2e[se]->target();
-	if(verbose >= 2) printf("resolve small edge, edge = %d, weight = %.2lf, ratio = %.2lf, vertex = (%d, %d), degree = (%d, %d)\n", 
+	if(cfg->verbose >= 2) printf("resolve small edge, edge = %d, weight = %.2lf, ratio = %.2lf, vertex = (%d, %d), degree = (%d, %d)\n", 
 			se, sw, ratio, s, t, gr.out_degree(s), gr.in_degree(t));
 
 	remove_edge(se);
@@ -202,7 +255,7 @@ bool scallop::resolve_negligible_edges(bool extend, double max_ratio)
 			double w = gr.get_edge_weight(e);
 			if(w > max_ratio * ww1) continue;
 			if(extend && hs.right_extend(e2i[e])) continue;
-			if(verbose >= 2) printf("resolve in-negligible edge, degree = (%d, %d), vertex = %d, weight = %.3lf / %.3lf\n", gr.in_degree(i), gr.out_degree(i), i, w, ww1);
+			if(cfg->verbose >= 2) printf("resolve in-negligible edge, degree = (%d, %d), vertex = %d, weight = %.3lf / %.3lf\n", gr.in_degree(i), gr.out_degree(i), i, w, ww1);
 			s.insert(e2i[e]);
 		}
 		for(tie(it1, it2) = gr.out_edges(i); it1 != it2; it1++)
@@ -211,7 +264,7 @@ bool scallop::resolve_negligible_edges(bool extend, double max_ratio)
 			double w = gr.get_edge_weight(e);
 			if(w > max_ratio * ww2) continue;
 			if(extend && hs.left_extend(e2i[e])) continue;
-			if(verbose >= 2) printf("resolve out-negligible edge, degree = (%d, %d), vertex = %d, weight = %.3lf / %.3lf\n", gr.in_degree(i), gr.out_degree(i), i, w, ww1);
+			if(cfg->verbose >= 2) printf("resolve out-negligible edge, degree = (%d, %d), vertex = %d, weight = %.3lf / %.3lf\n", gr.in_degree(i), gr.out_degree(i), i, w, ww1);
 			s.insert(e2i[e]);
 		}
 
@@ -270,7 +323,7 @@ bool scallop::resolve_splittable_vertex(int type, int degree, double max_ratio)
 
 	if(root == -1) return false;
 
-	if(verbose >= 2) printf("resolve splittable vertex, type = %d, degree = %d, vertex = %d, ratio = %.2lf, degree = (%d, %d)\n", 
+	if(cfg->verbose >= 2) printf("resolve splittable vertex, type = %d, degree = %d, vertex = %d, ratio = %.2lf, degree = (%d, %d)\n", 
 			type, degree, root, ratio, gr.in_degree(root), gr.out_degree(root));
 
 	split_vertex(root, eqns[0].s, eqns[0].t);
@@ -308,7 +361,7 @@ bool scallop::resolve_unsplittable_vertex(int type, int degree, double max_ratio
 
 		if(rt.ratio < -0.5)
 		{
-			if(verbose >= 2) printf("resolve unsplittable vertex, type = %d, degree = %d, vertex = %d, ratio = %.3lf, degree = (%d, %d)\n",
+			if(cfg->verbose >= 2) printf("resolve unsplittable vertex, type = %d, degree = %d, vertex = %d, ratio = %.3lf, degree = (%d, %d)\n",
 					type, degree, i, rt.ratio, gr.in_degree(i), gr.out_degree(i));
 			decompose_vertex_extend(i, rt.pe2w);
 			flag = true;
@@ -325,7 +378,7 @@ bool scallop::resolve_unsplittable_vertex(int type, int degree, double max_ratio
 	if(flag == true) return true;
 	if(root == -1) return false;
 
-	if(verbose >= 2) printf("resolve unsplittable vertex, type = %d, degree = %d, vertex = %d, ratio = %.3lf, degree = (%d, %d)\n",
+	if(cfg->verbose >= 2) printf("resolve unsplittable vertex, type = %d, degree = %d, vertex = %d, ratio = %.3lf, degree = (%d, %d)\n",
 			type, degree, root, ratio, gr.in_degree(root), gr.out_degree(root));
 
 	decompose_vertex_extend(root, pe2w);
@@ -368,7 +421,7 @@ bool scallop::resolve_hyper_edge(int fsize)
 	if(v1.size() == 0 || v2.size() == 0) return false;
 	assert(v1.size() == 1 || v2.size() == 1);
 
-	if(verbose >= 2) printf("resolve hyper edge, fsize = %d, vertex = %d, degree = (%d, %d), hyper edge = (%lu, %lu)\n",
+	if(cfg->verbose >= 2) printf("resolve hyper edge, fsize = %d, vertex = %d, degree = (%d, %d), hyper edge = (%lu, %lu)\n",
 			fsize, root, gr.in_degree(root), gr.out_degree(root), v1.size(), v2.size());
 
 	balance_vertex(root);
@@ -447,7 +500,7 @@ bool scallop::resolve_trivial_vertex(int type, double jump_ratio)
 
 		if(r < 1.02)
 		{
-			if(verbose >= 2) printf("resolve trivial vertex %d, type = %d, ratio = %.2lf, degree = (%d, %d)\n", i, type, 
+			if(cfg->verbose >= 2) printf("resolve trivial vertex %d, type = %d, ratio = %.2lf, degree = (%d, %d)\n", i, type, 
 					r, gr.in_degree(i), gr.out_degree(i));
 
 			decompose_trivial_vertex(i);
@@ -467,7 +520,7 @@ bool scallop::resolve_trivial_vertex(int type, double jump_ratio)
 	if(flag == true) return true;
 	if(root == -1) return false;
 
-	if(verbose >= 2) printf("resolve trivial vertex %d, type = %d, ratio = %.2lf, degree = (%d, %d)\n", root, type, 
+	if(cfg->verbose >= 2) printf("resolve trivial vertex %d, type = %d, ratio = %.2lf, degree = (%d, %d)\n", root, type, 
 			ratio, gr.in_degree(root), gr.out_degree(root));
 
 	decompose_trivial_vertex(root);
@@ -500,7 +553,7 @@ bool scallop::resolve_single_trivial_vertex_fast(int i, double jump_ratio)
 	double r = compute_balance_ratio(i);
 	if(r >= jump_ratio) return false;
 
-	if(verbose >= 2) printf("resolve trivial vertex fast, vertex = %d, ratio = %.2lf, degree = (%d, %d)\n",
+	if(cfg->verbose >= 2) printf("resolve trivial vertex fast, vertex = %d, ratio = %.2lf, degree = (%d, %d)\n",
 			i, r, gr.in_degree(i), gr.out_degree(i));
 
 	decompose_trivial_vertex(i);
@@ -788,12 +841,12 @@ int scallop::decompose_vertex_extend(int root, MPID &pe2w)
 	for(map<int, int>::iterator it = ev1.begin(); it != ev1.end(); it++)
 	{
 		int k = it->second;
-		resolve_single_trivial_vertex_fast(k, max_decompose_error_ratio[TRIVIAL_VERTEX]);
+		resolve_single_trivial_vertex_fast(k, cfg->max_decompose_error_ratio[TRIVIAL_VERTEX]);
 	}
 	for(map<int, int>::iterator it = ev2.begin(); it != ev2.end(); it++)
 	{
 		int k = it->second;
-		resolve_single_trivial_vertex_fast(k, max_decompose_error_ratio[TRIVIAL_VERTEX]);
+		resolve_single_trivial_vertex_fast(k, cfg->max_decompose_error_ratio[TRIVIAL_VERTEX]);
 	}
 
 	return 0;
@@ -1353,20 +1406,29 @@ int scallop::greedy_decompose()
 	for(int i = 1; i < gr.num_vertices() - 1; i++) balance_vertex(i);
 	for(int i = 1; i < gr.num_vertices() - 1; i++) balance_vertex(i);
 
+	bottleneck_path bp(gr);
+	bp.build();
+
 	int cnt = 0;
 	int n1 = paths.size();
 	while(true)
 	{
 		VE v;
-		double w = gr.compute_maximum_path_w(v);
-		if(w <= min_transcript_coverage) break;
+		double w = bp.extract(v);
+		if(w <= cfg->min_transcript_coverage) break;
+		if(check_guard() == true) break;
+
+		// only edges into the vertices of v are changed
+		vector<int> vv;
+		for(int i = 0; i < v.size(); i++) vv.push_back(v[i]->target());
 
 		int e = split_merge_path(v, w);
 		collect_path(e);
+		bp.update(vv);
 		cnt++;
 	}
 	int n2 = paths.size();
-	if(verbose >= 2) printf("greedy decomposing produces %d / %d paths\n", n2 - n1, n2);
+	if(cfg->verbose >= 2) printf("greedy decomposing produces %d / %d paths\n", n2 - n1, n2);
 	return 0;
 }
 
@@ -7,11 +7,15 @@ See LICENSE for licensing.
 #ifndef __SCALLOP3_H__
 #define __SCALLOP3_H__
 
+#include <chrono>
+
 #include "splice_graph.h"
 #include "hyper_set.h"
 #include "equation.h"
 #include "router.h"
 #include "path.h"
+#include "watchdog.h"
+#include "config.h"
 
 typedef map< edge_descriptor, vector<int> > MEV;
 typedef pair< edge_descriptor, vector<int> > PEV;
@@ -26,7 +30,8 @@ class scallop
 {
 public:
 	scallop();
-	scallop(const splice_graph &gr, const hyper_set &hs);
+	scallop(const splice_graph &gr, const hyper_set &hs, const parameters &cfg);
+	scallop(splice_graph &&gr, hyper_set &&hs, const parameters &cfg);
 	virtual ~scallop();
 
 public:
@@ -43,9 +48,16 @@ public:
 	set<int> nonzeroset;				// vertices with degree >= 1
 	vector<path> paths;					// predicted paths
 	vector<transcript> trsts;			// predicted transcripts
+	bool budget_exceeded;				// decomposing stopped by budget
+	const watchdog *guard;				// polled in each round, may be NULL
+	bool aborted;						// stopped by guard, no transcripts
+	const parameters *cfg;				// parameters of the assembly
 
 private:
 	// init
+	int init();
+	bool exceed_budget(const chrono::steady_clock::time_point &start, int rounds);
+	bool check_guard();
 	int classify();
 	int init_vertex_map();
 	int init_super_edges();
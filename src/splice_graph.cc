@@ -31,6 +31,39 @@ splice_graph::splice_graph(const splice_graph &gr)
 	copy(gr, x2y, y2x);
 }
 
+splice_graph::splice_graph(splice_graph &&gr) noexcept
+	: directed_graph(std::move(gr)), 
+	chrm(std::move(gr.chrm)), gid(std::move(gr.gid)), strand(gr.strand),
+	vwrt(std::move(gr.vwrt)), vinf(std::move(gr.vinf)),
+	ewrt(std::move(gr.ewrt)), einf(std::move(gr.einf))
+{}
+
+splice_graph& splice_graph::operator=(const splice_graph &gr)
+{
+	if(this == &gr) return (*this);
+	chrm = gr.chrm;
+	gid = gr.gid;
+	strand = gr.strand;
+
+	MEE x2y;
+	MEE y2x;
+	copy(gr, x2y, y2x);
+	return (*this);
+}
+
+splice_graph& splice_graph::operator=(splice_graph &&gr)
+{
+	directed_graph::operator=(std::move(gr));
+	chrm = std::move(gr.chrm);
+	gid = std::move(gr.gid);
+	strand = gr.strand;
+	vwrt = std::move(gr.vwrt);
+	vinf = std::move(gr.vinf);
+	ewrt = std::move(gr.ewrt);
+	einf = std::move(gr.einf);
+	return (*this);
+}
+
 int splice_graph::copy(const splice_graph &gr, MEE &x2y, MEE &y2x)
 {
 	clear();
@@ -49,8 +82,8 @@ int splice_graph::copy(const splice_graph &gr, MEE &x2y, MEE &y2x)
 		set_edge_info(e, gr.get_edge_info(*it));
 
 		assert(e != NULL);
-		assert(ewrt.find(e) != ewrt.end());
-		assert(einf.find(e) != einf.end());
+		assert(e->index() < ewrt.size());
+		assert(e->index() < einf.size());
 		assert(x2y.find(*it) == x2y.end());
 		assert(y2x.find(e) == y2x.end());
 
@@ -88,16 +121,14 @@ vertex_info splice_graph::get_vertex_info(int v) const
 
 double splice_graph::get_edge_weight(edge_base *e) const
 {
-	MED::const_iterator it = ewrt.find(e);
-	assert(it != ewrt.end());
-	return it->second;
+	assert(e->index() >= 0 && e->index() < ewrt.size());
+	return ewrt[e->index()];
 }
 
-edge_info splice_graph::get_edge_info(edge_base *e) const
+const edge_info& splice_graph::get_edge_info(edge_base *e) const
 {
-	MEIF::const_iterator it = einf.find(e);
-	assert(it != einf.end());
-	return it->second;
+	assert(e->index() >= 0 && e->index() < einf.size());
+	return einf[e->index()];
 }
 
 int splice_graph::set_vertex_weight(int v, double w) 
@@ -118,19 +149,31 @@ int splice_graph::set_vertex_info(int v, const vertex_info &vi)
 
 int splice_graph::set_edge_weight(edge_base* e, double w) 
 {
-	if(ewrt.find(e) != ewrt.end()) ewrt[e] = w;
-	else ewrt.insert(PED(e, w));
+	int k = e->index();
+	assert(k >= 0 && k < edge_id_bound());
+	if(k >= ewrt.size()) ewrt.resize(edge_id_bound(), 0);
+	ewrt[k] = w;
 	return 0;
 }
 
 int splice_graph::set_edge_info(edge_base* e, const edge_info &ei) 
 {
-	if(einf.find(e) != einf.end()) einf[e] = ei;
-	else einf.insert(PEIF(e, ei));
+	int k = e->index();
+	assert(k >= 0 && k < edge_id_bound());
+	if(k < einf.size())
+	{
+		einf[k] = ei;
+		return 0;
+	}
+
+	// ei may refer to an element of einf
+	edge_info x = ei;
+	einf.resize(edge_id_bound());
+	einf[k] = x;
 	return 0;
 }
 
-MED splice_graph::get_edge_weights() const
+vector<double> splice_graph::get_edge_weights() const
 {
 	return ewrt;
 }
@@ -140,9 +183,9 @@ vector<double> splice_graph::get_vertex_weights() const
 	return vwrt;
 }
 
-int splice_graph::set_edge_weights(const MED &med)
+int splice_graph::set_edge_weights(const vector<double> &v)
 {
-	ewrt = med;
+	ewrt = v;
 	return 0;
 }
 
@@ -316,6 +359,124 @@ int splice_graph::build(const string &file)
 	return 0;
 }
 
+int splice_graph::save(ofstream &fout) const
+{
+	// binary form read back by load
+	int32_t l1 = chrm.size();
+	int32_t l2 = gid.size();
+	fout.write((const char*)(&l1), sizeof(l1));
+	fout.write(chrm.c_str(), l1);
+	fout.write((const char*)(&l2), sizeof(l2));
+	fout.write(gid.c_str(), l2);
+	fout.write((const char*)(&strand), sizeof(strand));
+
+	int32_t n = num_vertices();
+	fout.write((const char*)(&n), sizeof(n));
+	for(int i = 0; i < n; i++)
+	{
+		const vertex_info &vi = vinf[i];
+		fout.write((const char*)(&vwrt[i]), sizeof(double));
+		fout.write((const char*)(&vi.pos), sizeof(vi.pos));
+		fout.write((const char*)(&vi.lpos), sizeof(vi.lpos));
+		fout.write((const char*)(&vi.rpos), sizeof(vi.rpos));
+		fout.write((const char*)(&vi.stddev), sizeof(vi.stddev));
+		fout.write((const char*)(&vi.length), sizeof(vi.length));
+		fout.write((const char*)(&vi.sdist), sizeof(vi.sdist));
+		fout.write((const char*)(&vi.tdist), sizeof(vi.tdist));
+		fout.write((const char*)(&vi.type), sizeof(vi.type));
+		fout.write((const char*)(&vi.lstrand), sizeof(vi.lstrand));
+		fout.write((const char*)(&vi.rstrand), sizeof(vi.rstrand));
+	}
+
+	// edges in the order of edges(), as copy adds them
+	int32_t m = num_edges();
+	fout.write((const char*)(&m), sizeof(m));
+	PEEI p = edges();
+	for(edge_iterator it = p.first; it != p.second; it++)
+	{
+		int32_t x = (*it)->source();
+		int32_t y = (*it)->target();
+		double w = get_edge_weight(*it);
+		const edge_info &ei = get_edge_info(*it);
+		fout.write((const char*)(&x), sizeof(x));
+		fout.write((const char*)(&y), sizeof(y));
+		fout.write((const char*)(&w), sizeof(w));
+		fout.write((const char*)(&ei.stddev), sizeof(ei.stddev));
+		fout.write((const char*)(&ei.length), sizeof(ei.length));
+		fout.write((const char*)(&ei.type), sizeof(ei.type));
+		fout.write((const char*)(&ei.jid), sizeof(ei.jid));
+		fout.write((const char*)(&ei.weight), sizeof(ei.weight));
+		fout.write((const char*)(&ei.strand), sizeof(ei.strand));
+	}
+	return 0;
+}
+
+int splice_graph::load(ifstream &fin)
+{
+	// return -1 if fin is truncated or corrupted
+	clear();
+
+	int32_t l1 = 0, l2 = 0;
+	fin.read((char*)(&l1), sizeof(l1));
+	if(fin.fail() || l1 < 0 || l1 > 1048576) return -1;
+	chrm.resize(l1);
+	if(l1 >= 1) fin.read(&chrm[0], l1);
+	fin.read((char*)(&l2), sizeof(l2));
+	if(fin.fail() || l2 < 0 || l2 > 1048576) return -1;
+	gid.resize(l2);
+	if(l2 >= 1) fin.read(&gid[0], l2);
+	fin.read((char*)(&strand), sizeof(strand));
+
+	int32_t n = 0;
+	fin.read((char*)(&n), sizeof(n));
+	for(int i = 0; i < n && fin.good(); i++)
+	{
+		double w;
+		vertex_info vi;
+		fin.read((char*)(&w), sizeof(w));
+		fin.read((char*)(&vi.pos), sizeof(vi.pos));
+		fin.read((char*)(&vi.lpos), sizeof(vi.lpos));
+		fin.read((char*)(&vi.rpos), sizeof(vi.rpos));
+		fin.read((char*)(&vi.stddev), sizeof(vi.stddev));
+		fin.read((char*)(&vi.length), sizeof(vi.length));
+		fin.read((char*)(&vi.sdist), sizeof(vi.sdist));
+		fin.read((char*)(&vi.tdist), sizeof(vi.tdist));
+		fin.read((char*)(&vi.type), sizeof(vi.type));
+		fin.read((char*)(&vi.lstrand), sizeof(vi.lstrand));
+		fin.read((char*)(&vi.rstrand), sizeof(vi.rstrand));
+
+		add_vertex();
+		set_vertex_weight(i, w);
+		set_vertex_info(i, vi);
+	}
+
+	int32_t m = 0;
+	fin.read((char*)(&m), sizeof(m));
+	for(int i = 0; i < m && fin.good(); i++)
+	{
+		int32_t x, y;
+		double w;
+		edge_info ei;
+		fin.read((char*)(&x), sizeof(x));
+		fin.read((char*)(&y), sizeof(y));
+		fin.read((char*)(&w), sizeof(w));
+		fin.read((char*)(&ei.stddev), sizeof(ei.stddev));
+		fin.read((char*)(&ei.length), sizeof(ei.length));
+		fin.read((char*)(&ei.type), sizeof(ei.type));
+		fin.read((char*)(&ei.jid), sizeof(ei.jid));
+		fin.read((char*)(&ei.weight), sizeof(ei.weight));
+		fin.read((char*)(&ei.strand), sizeof(ei.strand));
+		if(fin.fail() || x < 0 || x >= n || y < 0 || y >= n || x == y) return -1;
+
+		edge_descriptor e = add_edge(x, y);
+		set_edge_weight(e, w);
+		set_edge_info(e, ei);
+	}
+
+	if(fin.fail() || num_vertices() != n) return -1;
+	return 0;
+}
+
 int splice_graph::write(const string &file) const
 {
 	ofstream fin(file.c_str());
@@ -374,9 +535,9 @@ int splice_graph::simulate(int nv, int ne, int mw)
 		if(p.second == true) continue;
 
 		edge_descriptor e = add_edge(s, t);
-		ewrt.insert(PED(e, f));
-		einf.insert(PEIF(e, edge_info()));
-		if(ewrt.size() >= ne) break;
+		set_edge_weight(e, f);
+		set_edge_info(e, edge_info());
+		if(num_edges() >= ne) break;
 	}
 
 	assert(in_degree(0) == 0);
@@ -390,22 +551,23 @@ int splice_graph::simulate(int nv, int ne, int mw)
 		if(w <= 0) break;
 		for(int i = 0; i < v.size(); i++)
 		{
-			ewrt[v[i]] -= w;
+			ewrt[v[i]->index()] -= w;
 			if(med.find(v[i]) == med.end()) med.insert(PED(v[i], w));
 			else med[v[i]] += w;
 		}
 	}
 
-	for(MED::iterator it = ewrt.begin(); it != ewrt.end(); it++)
+	VE ve;
+	for(edge_iterator it = se.begin(); it != se.end(); it++)
 	{
-		if(med.find(it->first) == med.end()) remove_edge(it->first);
+		if(med.find(*it) == med.end()) ve.push_back(*it);
 	}
+	for(int i = 0; i < ve.size(); i++) remove_edge(ve[i]);
 
-	ewrt = med;
-	einf.clear();
-	for(MED::iterator it = ewrt.begin(); it != ewrt.end(); it++)
+	for(MED::iterator it = med.begin(); it != med.end(); it++)
 	{
-		einf.insert(PEIF(it->first, edge_info()));
+		set_edge_weight(it->first, it->second);
+		set_edge_info(it->first, edge_info());
 	}
 
 	edge_iterator it1, it2;
@@ -414,12 +576,12 @@ int splice_graph::simulate(int nv, int ne, int mw)
 		int wx = 0;
 		for(tie(it1, it2) = in_edges(i); it1 != it2; it1++)
 		{
-			wx += (int)(ewrt[*it1]);
+			wx += (int)(ewrt[(*it1)->index()]);
 		}
 		int wy = 0;
 		for(tie(it1, it2) = out_edges(i); it1 != it2; it1++)
 		{
-			wy += (int)(ewrt[*it1]);
+			wy += (int)(ewrt[(*it1)->index()]);
 		}
 
 		if(i == 0) assert(wx == 0);
@@ -856,11 +1018,7 @@ int splice_graph::locate(int v)
 
 int splice_graph::round_weights()
 {
-	MED m = ewrt;
-	for(MED::iterator it = m.begin(); it != m.end(); it++)
-	{
-		it->second = 0.0;
-	}
+	vector<double> m(ewrt.size(), 0.0);
 
 	while(true)
 	{
@@ -890,9 +1048,10 @@ int splice_graph::round_weights()
 		
 		for(int i = 0; i < v.size(); i++)
 		{
-			m[v[i]] += ww;
-			ewrt[v[i]] -= ww;
-			if(ewrt[v[i]] <= 0) ewrt[v[i]] = 0;
+			int k = v[i]->index();
+			m[k] += ww;
+			ewrt[k] -= ww;
+			if(ewrt[k] <= 0) ewrt[k] = 0;
 		}
 	}
 
@@ -901,7 +1060,7 @@ int splice_graph::round_weights()
 	edge_iterator it1, it2;
 	for(tie(it1, it2) = out_edges(0); it1 != it2; it1++)
 	{
-		double w = ewrt[*it1];
+		double w = ewrt[(*it1)->index()];
 		vwrt[0] += w;
 	}
 
@@ -909,7 +1068,7 @@ int splice_graph::round_weights()
 	{
 		for(tie(it1, it2) = in_edges(i); it1 != it2; it1++)
 		{
-			double w = ewrt[*it1];
+			double w = ewrt[(*it1)->index()];
 			vwrt[i] += w;
 		}
 	}
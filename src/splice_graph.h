@@ -28,6 +28,9 @@ class splice_graph : public directed_graph
 public:
 	splice_graph();
 	splice_graph(const splice_graph &gr);
+	splice_graph(splice_graph &&gr) noexcept;
+	splice_graph& operator=(const splice_graph &gr);
+	splice_graph& operator=(splice_graph &&gr);
 	virtual ~splice_graph();
 
 public:
@@ -37,24 +40,24 @@ public:
 
 	vector<double> vwrt;
 	vector<vertex_info> vinf;
-	MED ewrt;
-	MEIF einf;
+	vector<double> ewrt;			// indexed by edge id
+	vector<edge_info> einf;			// indexed by edge id
 
 public:
 	// get and set properties
 	double get_vertex_weight(int v) const;
 	double get_edge_weight(edge_base *e) const;
 	vertex_info get_vertex_info(int v) const;
-	edge_info get_edge_info(edge_base *e) const;
+	const edge_info& get_edge_info(edge_base *e) const;
 
 	int set_vertex_weight(int v, double w);
 	int set_vertex_info(int v, const vertex_info &vi);
 	int set_edge_weight(edge_base *e, double w);
 	int set_edge_info(edge_base *e, const edge_info &ei);
 
-	MED get_edge_weights() const;
+	vector<double> get_edge_weights() const;
 	vector<double> get_vertex_weights() const;
-	int set_edge_weights(const MED & med);
+	int set_edge_weights(const vector<double> &v);
 	int set_vertex_weights(const vector<double> &v);
 
 	edge_descriptor max_out_edge(int v);
@@ -73,6 +76,8 @@ public:
 	// read, write, and simulate splice graph
 	int build(const string &file);
 	int write(const string &file) const;
+	int save(ofstream &fout) const;
+	int load(ifstream &fin);
 	int simulate(int nv, int ne, int mf);
 
 	// analysis the structure of splice graph
@@ -13,6 +13,10 @@ super_graph::super_graph(const splice_graph &gr, const hyper_set &hs)
 	:root(gr), hyper(hs)
 {}
 
+super_graph::super_graph(splice_graph &&gr, hyper_set &&hs)
+	:root(std::move(gr)), hyper(std::move(hs))
+{}
+
 super_graph::~super_graph()
 {}
 
@@ -66,8 +70,8 @@ int super_graph::split_splice_graph()
 		split_single_splice_graph(gr, hs, s, index);
 		gr.chrm = root.chrm;
 		gr.strand = root.strand;
-		subs.push_back(gr);
-		hss.push_back(hs);
+		subs.push_back(std::move(gr));
+		hss.push_back(std::move(hs));
 		index++;
 	}
 	return 0;
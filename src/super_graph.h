@@ -21,6 +21,7 @@ class super_graph
 {
 public:
 	super_graph(const splice_graph &gr, const hyper_set &hs);
+	super_graph(splice_graph &&gr, hyper_set &&hs);
 	virtual ~super_graph();
 
 public:
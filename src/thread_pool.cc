@@ -0,0 +1,102 @@
+/*
+Part of Scallop Transcript Assembler
+(c) 2017 by  Mingfu Shao, Carl Kingsford, and Carnegie Mellon University.
+See LICENSE for licensing.
+*/
+
+#include <cassert>
+#include <algorithm>
+
+#include "thread_pool.h"
+
+task_batch::task_batch(int _n, const function<void(int)> &_f)
+	: n(_n), next(0), done(0), f(_f)
+{}
+
+thread_pool::thread_pool(int num_threads)
+{
+	stop = false;
+	for(int i = 1; i < num_threads; i++)
+	{
+		workers.push_back(thread(&thread_pool::work, this));
+	}
+}
+
+thread_pool::~thread_pool()
+{
+	{
+		unique_lock<mutex> lock(mtx);
+		stop = true;
+	}
+	cv.notify_all();
+	for(int i = 0; i < workers.size(); i++) workers[i].join();
+}
+
+int thread_pool::size() const
+{
+	return workers.size() + 1;
+}
+
+int thread_pool::run(int n, const function<void(int)> &f)
+{
+	if(n <= 0) return 0;
+
+	if(workers.size() == 0 || n == 1)
+	{
+		for(int i = 0; i < n; i++) f(i);
+		return 0;
+	}
+
+	task_batch b(n, f);
+
+	unique_lock<mutex> lock(mtx);
+	batches.push_back(&b);
+	cv.notify_all();
+
+	// execute tasks of this batch
+	while(b.next < b.n)
+	{
+		int i = b.next++;
+		if(b.next == b.n) batches.erase(find(batches.begin(), batches.end(), &b));
+
+		lock.unlock();
+		b.f(i);
+		lock.lock();
+
+		finish(b);
+	}
+
+	// wait for tasks executed by workers
+	while(b.done < b.n) cv.wait(lock);
+
+	return 0;
+}
+
+int thread_pool::work()
+{
+	unique_lock<mutex> lock(mtx);
+	while(true)
+	{
+		while(stop == false && batches.size() == 0) cv.wait(lock);
+		if(stop == true) break;
+
+		task_batch &b = *(batches.front());
+		int i = b.next++;
+		if(b.next == b.n) batches.pop_front();
+
+		lock.unlock();
+		b.f(i);
+		lock.lock();
+
+		finish(b);
+	}
+	return 0;
+}
+
+int thread_pool::finish(task_batch &b)
+{
+	b.done++;
+	assert(b.done <= b.n);
+	if(b.done == b.n) cv.notify_all();
+	return 0;
+}
@@ -0,0 +1,58 @@
+/*
+Part of Scallop Transcript Assembler
+(c) 2017 by  Mingfu Shao, Carl Kingsford, and Carnegie Mellon University.
+See LICENSE for licensing.
+*/
+
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+using namespace std;
+
+// a batch of n tasks f(0), ..., f(n - 1)
+class task_batch
+{
+public:
+	task_batch(int _n, const function<void(int)> &_f);
+
+public:
+	int n;								// number of tasks
+	int next;							// next task to be started
+	int done;							// number of finished tasks
+	const function<void(int)> &f;		// task body
+};
+
+// fixed set of workers shared by all levels of parallelism;
+// the thread calling run also executes tasks of its own batch
+// and only waits for those being executed by others, so nested
+// calls of run (from inside a task) can not deadlock
+class thread_pool
+{
+public:
+	thread_pool(int num_threads);
+	~thread_pool();
+
+private:
+	vector<thread> workers;				// num_threads - 1 workers
+	deque<task_batch*> batches;			// batches with tasks not yet started
+	mutex mtx;							// guards batches and task counters
+	condition_variable cv;				// signals new batches and finished tasks
+	bool stop;							// workers exit when set
+
+public:
+	int run(int n, const function<void(int)> &f);
+	int size() const;
+
+private:
+	int work();
+	int finish(task_batch &b);
+};
+
+#endif
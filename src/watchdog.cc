@@ -0,0 +1,90 @@
+/*
+Part of Scallop Transcript Assembler
+(c) 2017 by  Mingfu Shao, Carl Kingsford, and Carnegie Mellon University.
+See LICENSE for licensing.
+*/
+
+#include <cstdio>
+#include <unistd.h>
+
+#include "watchdog.h"
+
+watchdog::watchdog()
+{
+	max_seconds = 0;
+	max_bytes = 0;
+	base_bytes = 0;
+	cause = WATCHDOG_OK;
+	polls = 0;
+}
+
+int watchdog::start(double seconds, double mb)
+{
+	start_time = chrono::steady_clock::now();
+	max_seconds = seconds;
+	max_bytes = (int64_t)(mb * 1048576.0);
+	base_bytes = (max_bytes > 0) ? resident_bytes() : 0;
+	cause = WATCHDOG_OK;
+	polls = 0;
+	return 0;
+}
+
+int watchdog::stop()
+{
+	max_seconds = 0;
+	max_bytes = 0;
+	return 0;
+}
+
+bool watchdog::enabled() const
+{
+	return (max_seconds > 0 || max_bytes > 0);
+}
+
+bool watchdog::expired() const
+{
+	if(cause != WATCHDOG_OK) return true;
+	if(enabled() == false) return false;
+
+	if(max_seconds > 0 && elapsed() >= max_seconds) cause = WATCHDOG_TIME;
+
+	// reading the resident size is costly, only sample it
+	if(max_bytes > 0 && (polls++ % 16) == 0 && memory_growth() >= max_bytes) cause = WATCHDOG_MEMORY;
+
+	return (cause != WATCHDOG_OK);
+}
+
+int watchdog::reason() const
+{
+	return cause;
+}
+
+string watchdog::reason_string() const
+{
+	if(cause == WATCHDOG_TIME) return "time";
+	if(cause == WATCHDOG_MEMORY) return "memory";
+	return "none";
+}
+
+double watchdog::elapsed() const
+{
+	chrono::duration<double> d = chrono::steady_clock::now() - start_time;
+	return d.count();
+}
+
+int64_t watchdog::memory_growth() const
+{
+	return resident_bytes() - base_bytes;
+}
+
+int64_t watchdog::resident_bytes()
+{
+	// resident pages are the second field of /proc/self/statm
+	FILE *f = fopen("/proc/self/statm", "r");
+	if(f == NULL) return 0;
+	long size = 0, resident = 0;
+	int n = fscanf(f, "%ld %ld", &size, &resident);
+	fclose(f);
+	if(n != 2) return 0;
+	return (int64_t)(resident) * sysconf(_SC_PAGESIZE);
+}
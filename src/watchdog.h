@@ -0,0 +1,51 @@
+/*
+Part of Scallop Transcript Assembler
+(c) 2017 by  Mingfu Shao, Carl Kingsford, and Carnegie Mellon University.
+See LICENSE for licensing.
+*/
+
+#ifndef __WATCHDOG_H__
+#define __WATCHDOG_H__
+
+#include <stdint.h>
+#include <string>
+#include <chrono>
+#include <atomic>
+
+using namespace std;
+
+#define WATCHDOG_OK 0
+#define WATCHDOG_TIME 1
+#define WATCHDOG_MEMORY 2
+
+// wall-time and memory ceilings for processing one bundle;
+// expired() is polled by the stages of bundle and scallop 
+// and can be called from several threads at the same time
+class watchdog
+{
+public:
+	watchdog();
+
+private:
+	chrono::steady_clock::time_point start_time;
+	double max_seconds;				// 0 means no time limit
+	int64_t max_bytes;				// 0 means no memory limit
+	int64_t base_bytes;				// resident memory when started
+	mutable atomic<int> cause;		// why the watchdog fired
+	mutable atomic<int> polls;		// number of calls of expired
+
+public:
+	int start(double seconds, double mb);
+	int stop();
+	bool enabled() const;
+	bool expired() const;
+	int reason() const;
+	string reason_string() const;
+	double elapsed() const;
+	int64_t memory_growth() const;
+
+private:
+	static int64_t resident_bytes();
+};
+
+#endif